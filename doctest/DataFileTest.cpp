@@ -2,8 +2,19 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "..\src\DataFile.h"
+#include "..\src\DataFileCache.h"
+#include "..\src\Varint.h"
+#include "..\src\Crc32c.h"
+#include "..\src\MerkleTree.h"
+#include "..\src\Lz4.h"
+#include "..\src\BitPack.h"
+#include "..\src\BitStream.h"
+#include "..\src\StreamVByte.h"
+#include "..\src\BloomFilter.h"
+#include "..\src\ColumnFile.h"
 #include "testItem.cpp"
 #include <sstream>
+#include <filesystem>
 
 
 
@@ -173,3 +184,1832 @@ TEST_CASE("Verify DataFile functions") {
     file.close();
 }
 
+TEST_CASE("Verify DataFile::openAll") {
+
+    std::filesystem::path dir = std::filesystem::path(".") / "doctest" / "data" / "open_all";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::string dir_path = dir.string() + static_cast<char>(std::filesystem::path::preferred_separator);
+
+    for (int i = 0; i < 8; ++i) {
+        DataFile file("item_" + std::to_string(i), dir_path, OpenMode::overwrite);
+        file.write(&i);
+    }
+    DataFile other("other.bin", dir_path, OpenMode::overwrite);
+    other.close();
+
+    DataFile::OpenAllResult result = DataFile::openAll(dir.string(), "item_?.dat", OpenMode::readonly, 3);
+
+    REQUIRE(result.files.size() == 8);
+    CHECK(result.errors.empty());
+
+    for (int i = 0; i < 8; ++i) {
+        int value = -1;
+        CHECK(result.files[i]->isOpen());
+        CHECK(result.files[i]->getFileName() == "item_" + std::to_string(i) + ".dat");
+        result.files[i]->read(&value);
+        CHECK(value == i);
+    }
+
+    result = DataFile::openAll(dir.string(), "*.bin");
+    CHECK(result.files.size() == 1);
+
+    // names are opened as listed, without the default extension
+    {
+        std::ofstream plain(dir / "notes", std::ios::binary);
+        plain.put('x');
+    }
+    result = DataFile::openAll(dir.string(), "notes", OpenMode::edit);
+    REQUIRE(result.files.size() == 1);
+    CHECK(result.files[0]->getFileName() == "notes");
+    CHECK(result.files[0]->getFileSize() == 1);
+    CHECK(!std::filesystem::exists(dir / "notes.dat"));
+
+    // a file that cannot be opened is reported, not created elsewhere;
+    // skipped where permissions do not apply, as for root
+    std::filesystem::permissions(dir / "notes", std::filesystem::perms::none);
+    if (!std::ifstream(dir / "notes").is_open()) {
+        result = DataFile::openAll(dir.string(), "notes");
+        CHECK(result.files.empty());
+        REQUIRE(result.errors.size() == 1);
+        CHECK(result.errors[0].file_name == "notes");
+        CHECK(!std::filesystem::exists("notes"));
+    }
+    std::filesystem::permissions(dir / "notes", std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+
+    // a missing directory is an error, not an exception
+    result = DataFile::openAll((dir / "missing").string());
+    CHECK(result.files.empty());
+    CHECK(result.errors.size() == 1);
+}
+
+TEST_CASE("Verify DataFileCache") {
+
+    std::string file_path(".\\doctest\\data\\");
+    DataFileCache cache(2);
+
+    // first use of each file is a miss
+    for (int i = 0; i < 3; ++i) {
+        DataFile &file = cache.get("cache_" + std::to_string(i), file_path, OpenMode::overwrite);
+        file.write(&i);
+    }
+
+    CHECK(cache.getOpenCount() == 2);
+    CHECK(cache.getFileCount() == 3);
+    CHECK(cache.getMisses() == 3);
+    CHECK(cache.getEvictions() == 1);
+
+    // cache_2 is still open
+    DataFile &file_2 = cache.get("cache_2", file_path, OpenMode::overwrite);
+    CHECK(file_2.getWritePos() == sizeof(int));
+    CHECK(cache.getHits() == 1);
+
+    // cache_0 was evicted, reopening it keeps its contents and position
+    DataFile &file_0 = cache.get("cache_0", file_path, OpenMode::overwrite);
+    CHECK(cache.getReopens() == 1);
+    CHECK(cache.getEvictions() == 2);
+    CHECK(file_0.getFileSize() == sizeof(int));
+    CHECK(file_0.getWritePos() == sizeof(int));
+
+    int value = -1;
+    file_0.read(&value, 0);
+    CHECK(value == 0);
+
+    CHECK(cache.getHitRate() == doctest::Approx(1.0 / 5.0));
+
+    cache.setCapacity(1);
+    CHECK(cache.getOpenCount() == 1);
+
+    // the default extension names the same file
+    CHECK(&cache.get("cache_0.dat", file_path) == &file_0);
+    CHECK(cache.getFileCount() == 3);
+
+    // a file closed by its user is reopened from the start, or simply erased
+    file_0.close();
+    CHECK(&cache.get("cache_0", file_path) == &file_0);
+    CHECK(file_0.isOpen());
+    CHECK(file_0.getReadPos() == 0);
+    CHECK(cache.getOpenCount() == 1);
+    file_0.close();
+    cache.erase("cache_0", file_path);
+    CHECK(cache.getOpenCount() == 0);
+    CHECK(cache.getFileCount() == 2);
+    CHECK(cache.get("cache_1", file_path).isOpen());
+    CHECK(cache.getOpenCount() == 1);
+
+    cache.clear();
+    CHECK(cache.getFileCount() == 0);
+}
+
+TEST_CASE("Verify DataFile move and swap") {
+
+    std::string file_path(".\\doctest\\data\\");
+    short values[4] = {11, 22, 33, 44};
+
+    DataFile file("move_test", file_path, OpenMode::overwrite);
+    file.writeArray(values, 4);
+    file.close();
+    file.open(OpenMode::readonly);
+
+    short value = 0;
+    file.read(&value);
+    CHECK(value == 11);
+
+    // moving keeps the open file and its position
+    std::vector<DataFile> files;
+    files.push_back(std::move(file));
+    CHECK_FALSE(file.isOpen());
+    REQUIRE(files[0].isOpen());
+    CHECK(files[0].getReadPos() == sizeof(short));
+    files[0].read(&value);
+    CHECK(value == 22);
+
+    DataFile moved;
+    moved = std::move(files[0]);
+    CHECK(moved.getFileName() == "move_test.dat");
+    moved.read(&value);
+    CHECK(value == 33);
+
+    DataFile other;
+    swap(moved, other);
+    CHECK_FALSE(moved.isOpen());
+    CHECK(other.isOpen());
+    other.read(&value);
+    CHECK(value == 44);
+
+    // a moved-from DataFile can be opened again
+    file.open("move_test", file_path, OpenMode::readonly);
+    CHECK(file.getFileSize() == sizeof(values));
+
+    // moving over a file whose close fails drops the error instead of
+    // terminating; a directory in place of the sidecar cannot be written
+    std::filesystem::remove_all(file_path + "move_fail_test.dat.bloom");
+    DataFile failing;
+    failing.setFilePath(file_path);
+    failing.setFileName("move_fail_test");
+    failing.enableBloomFilter(100);
+    failing.open(OpenMode::overwrite);
+    failing.writeArray(values, 4);
+    std::filesystem::create_directory(file_path + "move_fail_test.dat.bloom");
+    failing = std::move(file);
+    CHECK(failing.isOpen());
+    CHECK(failing.getFileName() == "move_test.dat");
+    std::filesystem::remove_all(file_path + "move_fail_test.dat.bloom");
+}
+
+TEST_CASE("Verify non-throwing reads and writes") {
+
+    std::string file_path(".\\doctest\\data\\");
+    DataFile file;
+
+    int value = 0;
+    CHECK(file.tryRead(&value) == FileStatus::not_open);
+
+    file.open("try_test", file_path, OpenMode::overwrite);
+    int values[3] = {7, 8, 9};
+    CHECK(file.tryWriteArray(values, 3) == FileStatus::ok);
+    CHECK(file.tryWrite(std::string("try")) == FileStatus::ok);
+    CHECK(file.tryWrite(std::string(USHRT_MAX + 1, 'x')) == FileStatus::length_error);
+    file.close();
+
+    file.open(OpenMode::readonly);
+
+    int read_values[3];
+    CHECK(file.tryReadArray(read_values, 3) == FileStatus::ok);
+    CHECK(read_values[2] == 9);
+
+    std::string str;
+    static_assert(noexcept(file.tryRead(str)) && noexcept(file.tryRead(str, 0)));
+    CHECK(file.tryRead(str) == FileStatus::ok);
+    CHECK(str == "try");
+
+    // reading past the end leaves the position unchanged and the file usable
+    int64_t end_pos = file.getReadPos();
+    CHECK(file.tryRead(&value) == FileStatus::end_of_file);
+    CHECK(file.good());
+    CHECK(file.getReadPos() == end_pos);
+
+    CHECK(file.tryRead(&value, 15) == FileStatus::end_of_file);
+    CHECK(file.getReadPos() == 15);
+    CHECK(file.tryRead(&value, 4) == FileStatus::ok);
+    CHECK(value == 8);
+    CHECK(file.tryRead(str, 14) == FileStatus::end_of_file);
+    CHECK(file.getReadPos() == 14);
+    CHECK(file.tryRead(&value, -1000) == FileStatus::out_of_range);
+
+    file.close();
+}
+
+TEST_CASE("Verify DataFile::Cursor") {
+
+    std::string file_path(".\\doctest\\data\\");
+    TestItem test_item("cursor", 0x1122334455667788, 3.5f);
+
+    DataFile file("cursor_test", file_path, OpenMode::overwrite);
+    for (int i = 0; i < 100; ++i)
+        test_item.serialize(file);
+    int tail = 0x7A11;
+    file.write(&tail);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    {
+        // small capacity so that reserve has to refill
+        DataFile::Cursor cursor = file.cursor(64);
+        for (int i = 0; i < 100; ++i) {
+            TestItem read_item;
+            cursor.reserve(sizeof(read_item.test_id));
+            read_item.test_id = cursor.get<unsigned int>();
+            cursor.get(read_item.test_str);
+            cursor.reserve(sizeof(read_item.test_long) + sizeof(read_item.test_float) + sizeof(read_item.test_foot));
+            cursor.get(&read_item.test_long);
+            cursor.get(&read_item.test_float);
+            cursor.getArray(read_item.test_foot, read_item.foot_len);
+
+            CHECK(read_item.test_id == test_item.test_id);
+            CHECK(read_item.test_str == test_item.test_str);
+            CHECK(read_item.test_long == test_item.test_long);
+            CHECK(read_item.test_foot[5] == test_item.test_foot[5]);
+        }
+
+        CHECK(cursor.getPos() == 100 * test_item.getSize());
+        CHECK(cursor.tryReserve(8) == FileStatus::end_of_file);
+        CHECK_THROWS_AS(cursor.reserve(8), std::out_of_range);
+        CHECK(cursor.available() == sizeof(tail));
+    }
+
+    // destroying the cursor moves the file back to where the cursor stopped
+    CHECK(file.getReadPos() == 100 * test_item.getSize());
+    int read_tail = 0;
+    file.read(&read_tail);
+    CHECK(read_tail == tail);
+
+    file.close();
+}
+
+TEST_CASE("Verify string reads") {
+
+    std::string file_path(".\\doctest\\data\\");
+    std::string with_null("embedded\0null", 13);
+
+    DataFile file("string_test", file_path, OpenMode::overwrite);
+    for (int i = 0; i < 50; ++i)
+        file.write(with_null);
+    file.close();
+    file.open(OpenMode::readonly);
+
+    SUBCASE("read into std::string keeps embedded nulls and capacity") {
+        std::string str;
+        str.reserve(64);
+        const char *storage = str.data();
+
+        file.read(str);
+        CHECK(str == with_null);
+        CHECK(str.size() == 13);
+        CHECK(str.data() == storage);
+    }
+
+    SUBCASE("read into StringArena") {
+        StringArena arena(256);
+        std::vector<std::string_view> views;
+
+        for (int i = 0; i < 50; ++i) {
+            std::string_view view;
+            file.read(view, arena);
+            views.push_back(view);
+        }
+        for (std::string_view view : views)
+            CHECK(view == with_null);
+        CHECK(arena.getBytesUsed() == 50 * with_null.size());
+
+        // a second batch of the same size reuses the chunks
+        size_t capacity = arena.getCapacity();
+        arena.reset();
+        file.setReadPosBegin();
+        for (int i = 0; i < 50; ++i) {
+            std::string_view view;
+            file.read(view, arena);
+            CHECK(view == with_null);
+        }
+        CHECK(arena.getCapacity() == capacity);
+    }
+
+    SUBCASE("read into std::pmr::string backed by a StringArena") {
+        StringArena arena(1024);
+        std::pmr::vector<std::pmr::string> batch(&arena);
+        batch.reserve(50);
+
+        for (int i = 0; i < 50; ++i) {
+            batch.emplace_back();
+            file.read(batch.back());
+        }
+        CHECK(std::string_view(batch[0]) == with_null);
+        CHECK(std::string_view(batch[49]) == with_null);
+        CHECK(batch[49].get_allocator().resource() == &arena);
+        CHECK(arena.getBytesUsed() >= 50 * sizeof(std::pmr::string));
+
+        arena.reset();
+        CHECK(arena.getBytesUsed() == 0);
+    }
+
+    file.close();
+}
+
+TEST_CASE("Verify varint string lengths") {
+
+    SUBCASE("Varint encode/decode") {
+        uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFF,
+                             0x00FFFFFFFFFFFFFF, 0x0100000000000000, 0xFFFFFFFFFFFFFFFF};
+        for (uint64_t value : values) {
+            unsigned char buffer[16] = {0};
+            int len = Varint::encode(value, buffer);
+            CHECK(len == Varint::size(value));
+
+            // padded buffer takes the fast path, exact buffer the byte loop
+            uint64_t decoded = 0;
+            CHECK(Varint::decode(buffer, buffer + 16, &decoded) == len);
+            CHECK(decoded == value);
+            CHECK(Varint::decode(buffer, buffer + len, &decoded) == len);
+            CHECK(decoded == value);
+            CHECK(Varint::decode(buffer, buffer + len - 1, &decoded) == 0);
+        }
+    }
+
+    std::string file_path(".\\doctest\\data\\");
+    std::string short_str("short");
+    std::string long_str(70000, 'L');
+
+    DataFile file;
+    file.setStringEncoding(StringEncoding::varint);
+    file.open("varint_test", file_path, OpenMode::overwrite);
+    file.write(short_str);
+    file.write(long_str);
+    CHECK(file.tryWrite(short_str) == FileStatus::ok);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    CHECK(file.getFileSize() == (1 + 5) + (3 + 70000) + (1 + 5));
+
+    std::string str;
+    file.read(str);
+    CHECK(str == short_str);
+    file.read(str);
+    CHECK(str == long_str);
+    CHECK(file.tryRead(str) == FileStatus::ok);
+    CHECK(str == short_str);
+    CHECK(file.tryRead(str) == FileStatus::end_of_file);
+
+    {
+        file.setReadPosBegin();
+        DataFile::Cursor cursor = file.cursor();
+        cursor.get(str);
+        CHECK(str == short_str);
+        cursor.get(str);
+        CHECK(str == long_str);
+        cursor.get(str);
+        CHECK(str == short_str);
+    }
+
+    // a damaged length longer than the file is caught before allocating
+    file.close();
+    file.open(OpenMode::overwrite);
+    unsigned char prefix[16];
+    int prefix_len = Varint::encode(uint64_t(1) << 40, prefix);
+    file.writeArray(prefix, prefix_len);
+    file.write(long_str);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(file.read(str), std::out_of_range);
+    file.setReadPosBegin();
+    CHECK(file.tryRead(str) == FileStatus::end_of_file);
+    CHECK(file.getReadPos() == 0);
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        std::string_view view;
+        file.setReadPosBegin();
+        CHECK_THROWS_AS(file.read(view, arena), std::out_of_range);
+    }
+    {
+        file.setReadPosBegin();
+        DataFile::Cursor cursor = file.cursor();
+        CHECK_THROWS_AS(cursor.get(str), std::out_of_range);
+    }
+
+    // fixed16 lengths still reject long strings
+    file.close();
+    file.setStringEncoding(StringEncoding::fixed16);
+    file.open(OpenMode::overwrite);
+    CHECK_THROWS_AS(file.write(long_str), std::length_error);
+    file.close();
+}
+
+TEST_CASE("Verify container reads and writes") {
+
+    std::string file_path(".\\doctest\\data\\");
+
+    std::vector<int64_t> longs = {1, -2, 3, -4, 5};
+    std::vector<std::string> strings = {"one", "", "three"};
+    std::vector<std::vector<short>> nested = {{1, 2}, {}, {3, 4, 5}};
+    std::vector<bool> flags = {true, false, true};
+    std::array<short, 6> foot = {1, 16, 256, 4096, -1, 15001};
+    std::array<std::string, 2> pair = {"left", "right"};
+    std::map<int, std::string> names = {{3, "c"}, {1, "a"}, {2, "b"}};
+
+    DataFile file;
+    file.setStringEncoding(StringEncoding::varint);
+    file.open("container_test", file_path, OpenMode::overwrite);
+    file.write(longs);
+    file.write(strings);
+    file.write(nested);
+    file.write(flags);
+    file.write(foot);
+    file.write(pair);
+    file.write(names);
+    file.close();
+
+    file.open(OpenMode::readonly);
+
+    // a bulk vector is one length prefix plus the raw elements
+    std::vector<int64_t> read_longs = {9, 9, 9, 9, 9, 9, 9, 9};
+    file.read(read_longs);
+    CHECK(read_longs == longs);
+    CHECK(file.getReadPos() == 1 + 5 * sizeof(int64_t));
+
+    std::vector<std::string> read_strings;
+    std::vector<std::vector<short>> read_nested;
+    std::vector<bool> read_flags;
+    std::array<short, 6> read_foot;
+    std::array<std::string, 2> read_pair;
+    std::map<int, std::string> read_names = {{7, "stale"}};
+
+    file.read(read_strings);
+    file.read(read_nested);
+    file.read(read_flags);
+    file.read(read_foot);
+    file.read(read_pair);
+    file.read(read_names);
+
+    CHECK(read_strings == strings);
+    CHECK(read_nested == nested);
+    CHECK(read_flags == flags);
+    CHECK(read_foot == foot);
+    CHECK(read_pair == pair);
+    CHECK(read_names == names);
+    CHECK(file.getReadPos() == file.getFileSize());
+
+    // pmr containers allocate from their resource
+    file.setReadPos(1 + 5 * sizeof(int64_t));
+    StringArena arena;
+    std::pmr::vector<std::pmr::string> pmr_strings(&arena);
+    file.read(pmr_strings);
+    REQUIRE(pmr_strings.size() == 3);
+    CHECK(std::string_view(pmr_strings[2]) == "three");
+    CHECK(pmr_strings[2].get_allocator().resource() == &arena);
+
+    // damaged counts are caught before allocating, and any nonzero byte is true
+    file.close();
+    file.open(OpenMode::overwrite);
+    unsigned char prefix[16];
+    int prefix_len = Varint::encode(uint64_t(1) << 40, prefix);
+    file.writeArray(prefix, prefix_len);
+    file.write(longs);
+    uint8_t damaged_flags[5] = {4, 3, 0, 2, 0xFF};
+    file.writeArray(damaged_flags, 5);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(file.read(read_longs), std::out_of_range);
+    file.setReadPosBegin();
+    CHECK_THROWS_AS(file.read(read_strings), std::out_of_range);
+    file.setReadPos(prefix_len + 1 + 5 * sizeof(int64_t));
+    file.read(read_flags);
+    CHECK(read_flags == std::vector<bool>{true, false, true, true});
+
+    file.close();
+}
+
+// same sizes, different on-disk types
+struct SchemaItem {
+    int                 number;
+    float               real;
+    std::string         text;
+    std::vector<char>   chars;
+};
+
+TEST_CASE("Verify RecordFields") {
+
+    // the schema hash tells apart types of the same size
+    CHECK(RecordFields<&SchemaItem::number>::schema_hash != RecordFields<&SchemaItem::real>::schema_hash);
+    CHECK(RecordFields<&SchemaItem::text>::schema_hash != RecordFields<&SchemaItem::chars>::schema_hash);
+    CHECK(RecordFields<&SchemaItem::number, &SchemaItem::text>::schema_hash !=
+          RecordFields<&SchemaItem::text, &SchemaItem::number>::schema_hash);
+
+    // test_id, then test_long + test_float + test_foot as one run
+    CHECK(TestItemFields::field_count == 5);
+    CHECK(TestItemFields::static_size == 4 + 8 + 4 + 12);
+    CHECK_FALSE(TestItemFields::is_fixed_size);
+
+    TestItem test_item("record", 0x0102030405060708, 1.25f);
+    CHECK(TestItemFields::size(test_item) == 28 + 2 + 6);
+    CHECK(TestItemFields::size(test_item, StringEncoding::varint) == 28 + 1 + 6);
+
+    std::string file_path(".\\doctest\\data\\");
+    DataFile file("record_test", file_path, OpenMode::overwrite);
+    TestItemFields::serialize(file, test_item);
+
+    // same layout as writing every field separately
+    file.write(&test_item.test_id);
+    file.write(test_item.test_str);
+    file.write(&test_item.test_long);
+    file.write(&test_item.test_float);
+    file.writeArray(test_item.test_foot, test_item.foot_len);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    int64_t size = TestItemFields::size(test_item);
+    REQUIRE(file.getFileSize() == 2 * size);
+    std::vector<char> first(size), second(size);
+    file.readArray(first.data(), size, 0);
+    file.readArray(second.data(), size, size);
+    CHECK(first == second);
+
+    TestItem read_item;
+    TestItemFields::deserialize(file, read_item, size);
+    CHECK(read_item.test_str == test_item.test_str);
+    CHECK(read_item.test_long == test_item.test_long);
+    CHECK(read_item.test_float == test_item.test_float);
+    CHECK(read_item.test_foot[5] == test_item.test_foot[5]);
+
+    file.close();
+}
+
+TEST_CASE("Verify scalar reads and writes") {
+
+    struct Pair { int32_t a; int32_t b; };
+    struct Wide { int64_t a; int64_t b; };
+    struct Odd { char c[3]; };
+
+    std::string file_path(".\\doctest\\data\\");
+    DataFile file("scalar_test", file_path, OpenMode::overwrite);
+
+    uint8_t u8 = 0xAB;
+    uint16_t u16 = 0xBEEF;
+    float f32 = 2.5f;
+    double f64 = -1.0 / 3.0;
+    Pair pair = {7, -7};
+    Wide wide = {0x0102030405060708, -1};
+    Odd odd = {{'x', 'y', 'z'}};
+
+    file.write(&u8);
+    file.write(&u16);
+    file.write(&f32);
+    file.write(&f64);
+    file.write(&pair);
+    file.write(&wide);
+    CHECK(file.tryWrite(&odd) == FileStatus::ok);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    CHECK(file.getFileSize() == 1 + 2 + 4 + 8 + 8 + 16 + 3);
+
+    uint8_t read_u8;
+    uint16_t read_u16;
+    float read_f32;
+    double read_f64;
+    Pair read_pair;
+    Wide read_wide;
+    Odd read_odd;
+
+    file.read(&read_u8);
+    file.read(&read_u16);
+    file.read(&read_f32);
+    CHECK(file.tryRead(&read_f64) == FileStatus::ok);
+    file.read(&read_pair);
+    file.read(&read_wide);
+    file.read(&read_odd);
+
+    CHECK(read_u8 == u8);
+    CHECK(read_u16 == u16);
+    CHECK(read_f32 == f32);
+    CHECK(read_f64 == f64);
+    CHECK(read_pair.b == pair.b);
+    CHECK(read_wide.a == wide.a);
+    CHECK(read_odd.c[2] == 'z');
+
+    // a short read sets eof and fail like an fstream read, and leaves the
+    // value and the position unchanged
+    file.setReadPos(-2);
+    read_wide.a = 42;
+    CHECK_THROWS_AS(file.read(&read_wide), std::out_of_range);
+    CHECK(read_wide.a == 42);
+    CHECK(file.eof());
+    CHECK(file.fail());
+    file.clear();
+    CHECK(file.getReadPos() == file.getFileSize() - 2);
+    CHECK(file.tryRead(&read_u16) == FileStatus::ok);
+    CHECK(file.tryRead(&read_u8) == FileStatus::end_of_file);
+    CHECK(file.good());
+
+    file.close();
+}
+
+TEST_CASE("Verify byte order conversion") {
+
+    SUBCASE("ByteSwap arrays") {
+        // odd lengths cover both the vector and the scalar loops
+        std::vector<uint16_t> u16(37);
+        std::vector<uint32_t> u32(37);
+        std::vector<uint64_t> u64(37);
+        for (int i = 0; i < 37; ++i) {
+            u16[i] = static_cast<uint16_t>(0x0102 * (i + 1));
+            u32[i] = 0x01020304u * (i + 1);
+            u64[i] = 0x0102030405060708ull * (i + 1);
+        }
+        std::vector<uint16_t> swapped_16 = u16;
+        std::vector<uint32_t> swapped_32 = u32;
+        std::vector<uint64_t> swapped_64 = u64;
+        ByteSwap::swapArray(swapped_16.data(), 37);
+        ByteSwap::swapArray(swapped_32.data(), 37);
+        ByteSwap::swapArray(swapped_64.data(), 37);
+        for (int i = 0; i < 37; ++i) {
+            CHECK(swapped_16[i] == ByteSwap::swap16(u16[i]));
+            CHECK(swapped_32[i] == ByteSwap::swap32(u32[i]));
+            CHECK(swapped_64[i] == ByteSwap::swap64(u64[i]));
+        }
+    }
+
+    std::string file_path(".\\doctest\\data\\");
+    ByteOrder other_order = (std::endian::native == std::endian::little) ? ByteOrder::big : ByteOrder::little;
+    TestItem test_item("order", 0x0102030405060708, 6.25f);
+    std::vector<int32_t> values = {1, -2, 0x01020304};
+
+    DataFile file;
+    file.setByteOrder(other_order);
+    CHECK(file.needsByteSwap());
+    file.open("byte_order_test", file_path, OpenMode::overwrite);
+    test_item.serialize(file);
+    file.write(values);
+    file.close();
+
+    // the raw bytes are in the other byte order
+    file.setByteOrder(ByteOrder::native);
+    file.open(OpenMode::readonly);
+    unsigned int raw_id;
+    file.read(&raw_id, 0);
+    CHECK(raw_id == ByteSwap::swap32(test_item.test_id));
+    file.close();
+
+    file.setByteOrder(other_order);
+    file.open(OpenMode::readonly);
+
+    TestItem read_item;
+    read_item.deserialize(file);
+    CHECK(read_item.test_id == test_item.test_id);
+    CHECK(read_item.test_str == test_item.test_str);
+    CHECK(read_item.test_long == test_item.test_long);
+    CHECK(read_item.test_float == test_item.test_float);
+    CHECK(read_item.test_foot[3] == test_item.test_foot[3]);
+
+    std::vector<int32_t> read_values;
+    file.read(read_values);
+    CHECK(read_values == values);
+
+    // plain read/readArray and the cursor agree
+    file.setReadPosBegin();
+    unsigned int id;
+    file.read(&id);
+    CHECK(id == test_item.test_id);
+    file.setReadPos(test_item.getSize() + 2);
+    int32_t read_array[3];
+    file.readArray(read_array, 3);
+    CHECK(read_array[2] == values[2]);
+
+    file.setReadPosBegin();
+    {
+        DataFile::Cursor cursor = file.cursor();
+        cursor.reserve(4);
+        CHECK(cursor.get<unsigned int>() == test_item.test_id);
+        std::string str;
+        cursor.get(str);
+        CHECK(str == test_item.test_str);
+    }
+
+    file.close();
+}
+
+
+TEST_CASE("Verify file header") {
+    std::string file_name = "header_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    FileHeader header;
+    header.magic = 0x54534554;
+    header.format_version = 2;
+    header.schema_hash = TestItemFields::schema_hash;
+
+    TestItem test_item;
+    test_item.test_id = 7;
+    test_item.test_str = "header";
+
+    // new file gets the header, positions start after it
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.close();
+    file.setHeader(header);
+    file.setByteOrder(ByteOrder::big);
+    file.setStringEncoding(StringEncoding::varint);
+    file.open(OpenMode::overwrite);
+    CHECK(file.hasHeader());
+    CHECK(file.getFileSize() == 0);
+    CHECK(file.getWritePos() == 0);
+    test_item.serialize(file);
+    CHECK(file.getWritePos() == TestItemFields::size(test_item, StringEncoding::varint));
+    file.close();
+    CHECK(std::filesystem::file_size(file_path + file_name) ==
+          static_cast<uintmax_t>(FileHeader::size + TestItemFields::size(test_item, StringEncoding::varint)));
+
+    // flags in the header replace the file's settings
+    DataFile reader(file_name, file_path, OpenMode::readonly);
+    CHECK(!reader.hasHeader());
+    reader.close();
+    reader.setHeader(header);
+    reader.open(OpenMode::readonly);
+    CHECK(reader.getByteOrder() == ByteOrder::big);
+    CHECK(reader.getStringEncoding() == StringEncoding::varint);
+    CHECK(reader.getHeader().format_version == 2);
+    CHECK(reader.getReadPos() == 0);
+    TestItem read_item;
+    read_item.deserialize(reader);
+    CHECK(read_item.test_id == test_item.test_id);
+    CHECK(read_item.test_str == test_item.test_str);
+    reader.setReadPos(0);
+    CHECK(reader.getReadPos() == 0);
+
+    // a negative position inside the header leaves the pointers where they were
+    int64_t data_size = reader.getFileSize();
+    reader.setReadPos(1);
+    CHECK(reader.tryRead(&read_item.test_id, -(data_size + 4)) == FileStatus::out_of_range);
+    CHECK(reader.getReadPos() == 1);
+    CHECK(reader.good());
+    CHECK(reader.tryRead(read_item.test_str, -(data_size + FileHeader::size)) == FileStatus::out_of_range);
+    CHECK(reader.getReadPos() == 1);
+    reader.setReadPos(0);
+    CHECK_THROWS(reader.setHeader(header));
+    reader.close();
+
+    // older format versions are accepted
+    FileHeader newer = header;
+    newer.format_version = 3;
+    reader.setHeader(newer);
+    CHECK_NOTHROW(reader.open(OpenMode::readonly));
+    reader.close();
+
+    // mismatches are rejected at open
+    FileHeader wrong = header;
+    wrong.magic = 0x12345678;
+    reader.setHeader(wrong);
+    CHECK_THROWS_AS(reader.open(OpenMode::readonly), std::runtime_error);
+    CHECK(!reader.isOpen());
+
+    wrong = header;
+    wrong.format_version = 1;
+    reader.setHeader(wrong);
+    CHECK_THROWS_AS(reader.open(OpenMode::readonly), std::runtime_error);
+
+    wrong = header;
+    wrong.schema_hash = header.schema_hash + 1;
+    reader.setHeader(wrong);
+    CHECK_THROWS_AS(reader.open(OpenMode::readonly), std::runtime_error);
+
+    // without a header the raw bytes are visible again
+    reader.clearHeader();
+    reader.setByteOrder(ByteOrder::little);
+    reader.open(OpenMode::readonly);
+    CHECK(reader.getFileSize() == FileHeader::size + TestItemFields::size(test_item, StringEncoding::varint));
+    uint32_t magic;
+    reader.read(&magic);
+    CHECK(magic == header.magic);
+    reader.close();
+}
+
+TEST_CASE("Verify block checksums") {
+    std::string file_name = "checksum_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+    std::filesystem::remove(file_path + file_name + ".crc");
+
+    CHECK(Crc32c::compute("123456789", 9) == 0xE3069283);
+    std::vector<unsigned char> bytes(50000);
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<unsigned char>(i * 31 + 7);
+    uint32_t pieces = Crc32c::extend(Crc32c::compute(bytes.data(), 12345), bytes.data() + 12345, bytes.size() - 12345);
+    CHECK(Crc32c::compute(bytes.data(), bytes.size()) == pieces);
+
+    // write across several blocks
+    const int64_t block_size = 64;
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.close();
+    file.enableChecksums(block_size);
+    CHECK_THROWS(file.enableChecksums(0));
+    file.open(OpenMode::overwrite);
+    CHECK(file.hasChecksums());
+
+    std::vector<int32_t> values(100);
+    for (int32_t i = 0; i < 100; ++i)
+        values[i] = i * i;
+    std::string str = "checksummed string";
+    file.write(str);
+    file.write(values);
+    file.write(str);
+    int64_t size = file.getFileSize();
+    CHECK(size == 2 + 18 + 2 + 400 + 2 + 18);
+    CHECK(file.verify(4).empty());
+    file.close();
+    CHECK(std::filesystem::exists(file_path + file_name + ".crc"));
+    CHECK(std::filesystem::file_size(file_path + file_name) == static_cast<uintmax_t>(size));
+
+    // rewrite a value in the middle
+    file.open(OpenMode::edit);
+    int32_t changed = -1;
+    file.write(&changed, 2 + 18 + 2 + 4 * 50);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    std::string read_str;
+    std::vector<int32_t> read_values;
+    file.read(read_str);
+    file.read(read_values);
+    CHECK(read_str == str);
+    CHECK(read_values[49] == values[49]);
+    CHECK(read_values[50] == -1);
+    file.read(read_str);
+    CHECK(read_str == str);
+    CHECK(file.verify().empty());
+    file.close();
+
+    // corrupt one byte of block 3 behind the checksums' back
+    {
+        std::fstream raw(file_path + file_name, std::ios::binary | std::ios::in | std::ios::out);
+        raw.seekp(3 * block_size + 5);
+        raw.put('\x7F');
+    }
+
+    file.open(OpenMode::readonly);
+    CHECK(file.verify(2) == std::vector<int64_t>{3});
+
+    int32_t value;
+    CHECK_NOTHROW(file.read(&value, 2 + 18 + 2));
+    CHECK(value == 0);
+    try {
+        file.read(&value, 3 * block_size);
+        FAIL("corrupt block was read");
+    } catch (const ChecksumError &e) {
+        CHECK(e.getBlock() == 3);
+    }
+    CHECK_THROWS_AS(file.readArray(read_values.data(), 60, 2 + 18 + 2), ChecksumError);
+    CHECK(file.tryRead(&value, 3 * block_size + 4) == FileStatus::checksum_error);
+    CHECK(file.getReadPos() == 3 * block_size + 4);
+    CHECK(file.tryRead(&value, 5 * block_size) == FileStatus::ok);
+    {
+        file.setReadPos(2 * block_size);
+        DataFile::Cursor cursor = file.cursor(64);
+        cursor.reserve(64);
+        CHECK_THROWS_AS(cursor.reserve(65), ChecksumError);
+    }
+    file.close();
+
+    // a file changed without its checksums is rejected
+    file.disableChecksums();
+    file.open(OpenMode::edit);
+    file.setWritePosEnd();
+    file.write(&changed);
+    file.close();
+    file.enableChecksums(block_size);
+    CHECK_THROWS_AS(file.open(OpenMode::edit), std::runtime_error);
+    CHECK(!file.isOpen());
+
+    // a new file starts over
+    file.open(OpenMode::overwrite);
+    file.write(str);
+    file.close();
+    file.open(OpenMode::readonly);
+    file.read(read_str);
+    CHECK(read_str == str);
+    file.close();
+}
+
+TEST_CASE("Verify Merkle tree") {
+    // incremental updates match a tree built in one pass
+    std::vector<uint64_t> leaves;
+    MerkleTree incremental;
+    for (uint64_t i = 0; i < 37; ++i) {
+        leaves.push_back(MerkleTree::leafHash(static_cast<uint32_t>(i * 7919), 64));
+        incremental.setLeaf(static_cast<int64_t>(i), leaves.back());
+        MerkleTree built;
+        built.assign(leaves);
+        CHECK(incremental.getRoot() == built.getRoot());
+    }
+    CHECK(incremental.getLeafCount() == 37);
+    CHECK(incremental.getHeight() == 7);
+
+    MerkleTree changed;
+    changed.assign(leaves);
+    CHECK(incremental.diff(changed).empty());
+    changed.setLeaf(5, 1);
+    changed.setLeaf(30, 2);
+    changed.setLeaf(40, 3);
+    CHECK(changed.getRoot() != incremental.getRoot());
+    CHECK(incremental.diff(changed) == std::vector<int64_t>{5, 30, 37, 38, 39, 40});
+    CHECK(changed.diff(incremental) == std::vector<int64_t>{5, 30, 37, 38, 39, 40});
+
+    // replicas
+    std::string file_path = ".\\doctest\\data\\";
+    const int64_t block_size = 32;
+    std::vector<int64_t> values(200);
+    for (int64_t i = 0; i < 200; ++i)
+        values[i] = i * 1000003;
+
+    for (std::string name : {"merkle_a.bin", "merkle_b.bin"}) {
+        std::filesystem::remove(file_path + name);
+        std::filesystem::remove(file_path + name + ".crc");
+        DataFile file(name, file_path, OpenMode::overwrite);
+        file.close();
+        file.enableChecksums(block_size);
+        file.open(OpenMode::overwrite);
+        file.writeArray(values.data(), 200);
+        file.close();
+    }
+
+    DataFile replica_a("merkle_a.bin", file_path, OpenMode::readonly);
+    replica_a.close();
+    replica_a.enableChecksums(block_size);
+    replica_a.open(OpenMode::edit);
+    DataFile replica_b("merkle_b.bin", file_path, OpenMode::readonly);
+    replica_b.close();
+    replica_b.enableChecksums(block_size);
+    replica_b.open(OpenMode::edit);
+
+    uint64_t root = replica_a.getRootHash();
+    CHECK(root == replica_b.getRootHash());
+    CHECK(replica_a.diffBlocks(replica_b).empty());
+
+    // small writes only change their blocks
+    int64_t value = -1;
+    replica_b.write(&value, 8 * 10);
+    replica_b.write(&value, 8 * 150);
+    CHECK(replica_b.getRootHash() != root);
+    CHECK(replica_a.diffBlocks(replica_b) == std::vector<int64_t>{2, 37});
+
+    // appending adds blocks
+    replica_b.setWritePosEnd();
+    replica_b.writeArray(values.data(), 8);
+    CHECK(replica_a.diffBlocks(replica_b) == std::vector<int64_t>{2, 37, 50, 51});
+    replica_b.close();
+
+    // the root is saved with the checksums and survives a reopen
+    replica_b.open(OpenMode::readonly);
+    CHECK(replica_a.diffBlocks(replica_b) == std::vector<int64_t>{2, 37, 50, 51});
+    uint64_t changed_root = replica_b.getRootHash();
+    replica_b.close();
+
+    replica_a.write(&value, 8 * 10);
+    replica_a.write(&value, 8 * 150);
+    replica_a.setWritePosEnd();
+    replica_a.writeArray(values.data(), 8);
+    CHECK(replica_a.getRootHash() == changed_root);
+    replica_a.close();
+
+    // a damaged sidecar is caught by its root
+    {
+        std::fstream raw(file_path + "merkle_a.bin.crc", std::ios::binary | std::ios::in | std::ios::out);
+        raw.seekp(ChecksumBuffer::header_size + 4 * 3);
+        raw.put('\x01');
+    }
+    CHECK_THROWS_AS(replica_a.open(OpenMode::readonly), std::runtime_error);
+}
+
+TEST_CASE("Verify block compression") {
+    std::string file_name = "compressed_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+    std::filesystem::remove(file_path + file_name + ".crc");
+
+    std::string text;
+    for (int i = 0; i < 200; ++i)
+        text += "row " + std::to_string(i % 7) + " of a fairly repetitive column; ";
+    std::vector<char> packed(static_cast<size_t>(Lz4::bound(text.size())));
+    int64_t packed_size = Lz4::compress(text.data(), text.size(), packed.data(), packed.size());
+    CHECK(packed_size > 0);
+    CHECK(packed_size < static_cast<int64_t>(text.size()) / 4);
+    std::string unpacked(text.size(), '\0');
+    CHECK(Lz4::decompress(packed.data(), packed_size, unpacked.data(), unpacked.size()) == static_cast<int64_t>(text.size()));
+    CHECK(unpacked == text);
+    CHECK(Lz4::decompress(packed.data(), packed_size - 1, unpacked.data(), unpacked.size()) < 0);
+
+    // write compressible values across many small blocks
+    const int64_t block_size = 256;
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.close();
+    file.enableCompression(block_size);
+    CHECK_THROWS(file.enableCompression(0));
+    file.open(OpenMode::overwrite);
+    CHECK(file.isCompressed());
+    CHECK_THROWS(file.disableCompression());
+
+    std::vector<int64_t> values(2000);
+    for (int64_t i = 0; i < 2000; ++i)
+        values[i] = i / 10;
+    file.write(values);
+    file.write(text);
+    int64_t size = file.getFileSize();
+    CHECK(size == 2 + 8 * 2000 + 2 + static_cast<int64_t>(text.size()));
+    file.close();
+    CHECK(std::filesystem::file_size(file_path + file_name) < static_cast<uintmax_t>(size / 3));
+
+    // read by logical position in any order
+    file.open(OpenMode::readonly);
+    CHECK(file.getFileSize() == size);
+    CHECK(file.getCompressionBlockSize() == block_size);
+    int64_t value;
+    for (int64_t i : {1999, 0, 1024, 31, 1500, 32, 999}) {
+        file.read(&value, 2 + 8 * i);
+        CHECK(value == i / 10);
+    }
+    std::vector<int64_t> read_values;
+    std::string read_text;
+    file.setReadPos(0);
+    file.read(read_values);
+    file.read(read_text);
+    CHECK(read_values == values);
+    CHECK(read_text == text);
+    CHECK(file.tryRead(&value) == FileStatus::end_of_file);
+    file.close();
+
+    // rewrite a value in place and append
+    file.open(OpenMode::edit);
+    value = -1;
+    file.write(&value, 2 + 8 * 1000);
+    file.setWritePos(size);
+    file.write(text);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    file.read(&value, 2 + 8 * 1000);
+    CHECK(value == -1);
+    file.read(&value, 2 + 8 * 1001);
+    CHECK(value == 100);
+    file.setReadPos(size);
+    file.read(read_text);
+    CHECK(read_text == text);
+    file.close();
+
+    // the header records compression, with checksums below it
+    FileHeader header;
+    header.magic = 0x50524D43;
+    std::filesystem::remove(file_path + file_name);
+    file.setHeader(header);
+    file.enableChecksums(128);
+    file.open(OpenMode::overwrite);
+    file.write(values);
+    CHECK(file.verify().empty());
+    file.close();
+
+    DataFile reader(file_name, file_path, OpenMode::readonly);
+    reader.close();
+    reader.setHeader(header);
+    reader.enableChecksums(128);
+    reader.open(OpenMode::readonly);
+    CHECK(reader.isCompressed());
+    CHECK(reader.getReadPos() == 0);
+    reader.read(read_values);
+    CHECK(read_values == values);
+    CHECK(reader.verify().empty());
+    reader.close();
+
+    // the header turns compression on for that open only
+    std::string plain_name = "compression_plain_test.bin";
+    std::filesystem::remove(file_path + plain_name);
+    std::filesystem::remove(file_path + plain_name + ".crc");
+    {
+        DataFile writer;
+        writer.setHeader(header);
+        writer.enableChecksums(128);
+        writer.open(plain_name, file_path, OpenMode::overwrite);
+        writer.write(values);
+    }
+    reader.open(plain_name, file_path, OpenMode::readonly);
+    CHECK(!reader.isCompressed());
+    reader.read(read_values);
+    CHECK(read_values == values);
+    reader.close();
+
+    // uncompressed files are rejected
+    std::filesystem::remove(file_path + file_name);
+    std::filesystem::remove(file_path + file_name + ".crc");
+    DataFile plain(file_name, file_path, OpenMode::overwrite);
+    plain.write(values);
+    plain.close();
+    reader.clearHeader();
+    reader.disableChecksums();
+    reader.open(file_name, file_path, OpenMode::readonly);
+    CHECK(!reader.isCompressed());
+    reader.read(read_values);
+    CHECK(read_values == values);
+    reader.close();
+    reader.enableCompression();
+    CHECK_THROWS_AS(reader.open(OpenMode::readonly), std::runtime_error);
+    CHECK(!reader.isOpen());
+}
+
+TEST_CASE("Verify parallel compression") {
+    std::string file_path = ".\\doctest\\data\\";
+    std::vector<int32_t> values(50000);
+    for (int32_t i = 0; i < 50000; ++i)
+        values[i] = (i % 1000 == 0) ? i * 7919 : i / 3;
+
+    // the same writes give the same file on any number of threads
+    std::vector<std::string> contents;
+    for (unsigned int threads : {1u, 2u, 4u}) {
+        std::string file_name = "parallel_test_" + std::to_string(threads) + ".bin";
+        std::filesystem::remove(file_path + file_name);
+        DataFile file(file_name, file_path, OpenMode::overwrite);
+        file.close();
+        file.enableCompression(512, threads);
+        file.open(OpenMode::overwrite);
+        file.write(values);
+        for (int32_t i = 0; i < 1000; ++i)
+            file.write(&values[i]);
+
+        // blocks still being compressed can be read back
+        int32_t value;
+        file.read(&value, 2 + 4 * 100);
+        CHECK(value == values[100]);
+        file.read(&value, 2 + 4 * 49000);
+        CHECK(value == values[49000]);
+        file.close();
+
+        std::ifstream raw(file_path + file_name, std::ios::binary);
+        contents.emplace_back(std::istreambuf_iterator<char>(raw), std::istreambuf_iterator<char>());
+
+        file.open(OpenMode::readonly);
+        std::vector<int32_t> read_values;
+        file.read(read_values);
+        CHECK(read_values == values);
+        file.read(&value);
+        CHECK(value == values[0]);
+        CHECK(file.getFileSize() == 2 + 4 * 50000 + 4 * 1000);
+        file.close();
+    }
+    CHECK(contents[0].size() < 2 + 4 * 50000);
+    CHECK(contents[1] == contents[0]);
+    CHECK(contents[2] == contents[0]);
+}
+
+TEST_CASE("Verify column files") {
+    std::string file_name = "column_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    std::vector<TestItem> items(1000);
+    for (int i = 0; i < 1000; ++i) {
+        items[i].test_id = i;
+        items[i].test_str = "item " + std::to_string(i);
+        items[i].test_long = 1000000LL * i;
+        items[i].test_float = i * 0.5f;
+        items[i].test_foot[5] = static_cast<short>(i);
+    }
+
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.close();
+    file.setByteOrder(ByteOrder::big);
+    file.open(OpenMode::overwrite);
+    {
+        ColumnWriter<TestItemFields> writer(file, 300);
+        CHECK_THROWS(ColumnWriter<TestItemFields>{file, 0});
+        writer.write(items.data(), 999);
+        CHECK(writer.getRowGroupCount() == 3);
+        writer.write(items[999]);
+        writer.finish();
+        CHECK(writer.getRowCount() == 1000);
+        CHECK(writer.getRowGroupCount() == 4);
+        CHECK_THROWS(writer.write(items[0]));
+    }
+    file.close();
+
+    // read single columns
+    file.open(OpenMode::readonly);
+    ColumnReader<TestItemFields> reader(file);
+    CHECK(reader.getRowCount() == 1000);
+    CHECK(reader.getRowGroupCount() == 4);
+    CHECK(reader.getRowGroupRows(3) == 100);
+    CHECK_THROWS_AS(reader.getRowGroupRows(4), std::out_of_range);
+
+    int64_t row = 0;
+    bool longs_match = true;
+    for (int64_t g = 0; g < reader.getRowGroupCount(); ++g) {
+        std::span<const long long> longs = reader.readColumn<&TestItem::test_long>(g);
+        CHECK(static_cast<int64_t>(longs.size()) == reader.getRowGroupRows(g));
+        for (long long value : longs)
+            longs_match = longs_match && value == items[row++].test_long;
+    }
+    CHECK(longs_match);
+    CHECK(row == 1000);
+
+    std::span<const short> feet = reader.readColumn<&TestItem::test_foot>(1);
+    CHECK(feet.size() == 300 * TestItem::foot_len);
+    CHECK(feet[0] == 1);
+    CHECK(feet[TestItem::foot_len + 5] == 301);
+    std::span<const std::string> strs = reader.readColumn<&TestItem::test_str>(2);
+    CHECK(strs[7] == "item 607");
+
+    // projection leaves the other fields alone
+    std::vector<TestItem> rows;
+    reader.readRows<&TestItem::test_long, &TestItem::test_float>(1, rows);
+    CHECK(rows.size() == 300);
+    CHECK(rows[10].test_long == items[310].test_long);
+    CHECK(rows[10].test_float == items[310].test_float);
+    CHECK(rows[10].test_str.empty());
+
+    reader.readRows(3, rows);
+    CHECK(rows.size() == 100);
+    CHECK(rows[99].test_id == 999);
+    CHECK(rows[99].test_str == "item 999");
+    CHECK(rows[99].test_foot[5] == 999);
+    file.close();
+
+    // other layouts and plain files are rejected
+    using OtherFields = RecordFields<&TestItem::test_id, &TestItem::test_long>;
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(ColumnReader<OtherFields>{file}, std::runtime_error);
+    file.close();
+
+    file.open(OpenMode::overwrite);
+    items[0].serialize(file);
+    file.close();
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(ColumnReader<TestItemFields>{file}, std::runtime_error);
+    file.close();
+
+    // damaged row counts and chunk sizes are rejected before anything is read
+    file.open(OpenMode::overwrite);
+    {
+        ColumnWriter<TestItemFields> writer(file, 300);
+        writer.write(items.data(), 10);
+        writer.finish();
+    }
+    file.close();
+    file.open(OpenMode::edit);
+    int64_t footer_offset;
+    file.read(&footer_offset, file.getFileSize() - 12);
+    int64_t group_rows = int64_t(1) << 40;
+    file.write(&group_rows, footer_offset + 20);
+    file.close();
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(ColumnReader<TestItemFields>{file}, std::runtime_error);
+    file.close();
+
+    file.open(OpenMode::edit);
+    group_rows = 10;
+    int64_t chunk_size = INT64_MAX;
+    file.write(&group_rows, footer_offset + 20);
+    file.write(&chunk_size, footer_offset + 36);
+    file.close();
+    file.open(OpenMode::readonly);
+    CHECK_THROWS_AS(ColumnReader<TestItemFields>{file}, std::runtime_error);
+}
+
+TEST_CASE("Verify packed integer arrays") {
+    std::string file_name = "packed_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    // every width in both layouts, including full-range values
+    uint64_t seed = 42;
+    auto next = [&seed]() {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed >> 11;
+    };
+    bool all_match = true;
+    for (int width = 0; width <= 64; ++width) {
+        std::vector<int64_t> values(300);
+        for (int64_t &value : values)
+            value = static_cast<int64_t>(width == 64 ? next() << 11 ^ next() : next() & ((1ull << width) - 1));
+        for (IntEncoding encoding : {IntEncoding::delta, IntEncoding::frame_of_reference}) {
+            std::vector<unsigned char> packed;
+            BitPack::encode(values.data(), 300, encoding, packed);
+            CHECK(static_cast<int64_t>(packed.size()) <= BitPack::maxPackedSize<int64_t>(300));
+            std::vector<int64_t> decoded(300);
+            all_match = all_match && BitPack::decode(packed.data(), packed.size(), decoded.data(), 300) && decoded == values;
+            all_match = all_match && !BitPack::decode(packed.data(), packed.size() - 1, decoded.data(), 300);
+        }
+    }
+    CHECK(all_match);
+
+    std::vector<short> shorts(1000);
+    for (int i = 0; i < 1000; ++i)
+        shorts[i] = static_cast<short>(i % 3 == 0 ? -i : i * 32);
+    std::vector<unsigned char> packed;
+    BitPack::encode(shorts.data(), 1000, IntEncoding::delta, packed);
+    std::vector<short> read_shorts(1000);
+    CHECK(BitPack::decode(packed.data(), packed.size(), read_shorts.data(), 1000));
+    CHECK(read_shorts == shorts);
+
+    // timestamps and small-range values shrink
+    std::vector<int64_t> times(10000);
+    std::vector<uint32_t> codes(10000);
+    for (int64_t i = 0; i < 10000; ++i) {
+        times[i] = 1700000000000LL + i * 1000 + static_cast<int64_t>(next() % 50);
+        codes[i] = 40000 + static_cast<uint32_t>(next() % 200);
+    }
+
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.close();
+    file.setByteOrder(ByteOrder::big);
+    file.open(OpenMode::overwrite);
+    file.writePackedArray(times.data(), 10000);
+    int64_t times_size = file.getWritePos();
+    file.writePackedArray(codes.data(), 10000, IntEncoding::frame_of_reference);
+    int64_t codes_size = file.getWritePos() - times_size;
+    CHECK(times_size * 5 < 8 * 10000);
+    CHECK(codes_size * 3 < 4 * 10000);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    std::vector<int64_t> read_times(10000);
+    std::vector<uint32_t> read_codes(10000);
+    file.readPackedArray(read_times.data(), 10000);
+    file.readPackedArray(read_codes.data(), 10000, times_size);
+    CHECK(read_times == times);
+    CHECK(read_codes == codes);
+    CHECK_THROWS_AS(file.readPackedArray(read_times.data(), 9999, 0), std::runtime_error);
+    file.close();
+
+    // packed columns
+    std::filesystem::remove(file_path + file_name);
+    std::vector<TestItem> items(500);
+    for (int i = 0; i < 500; ++i) {
+        items[i].test_id = 7 * i;
+        items[i].test_long = times[i];
+        items[i].test_foot[0] = static_cast<short>(i);
+    }
+    file.open(OpenMode::overwrite);
+    {
+        ColumnWriter<TestItemFields> writer(file, 200);
+        writer.setEncoding<&TestItem::test_long>(ColumnEncoding::delta);
+        writer.setEncoding<&TestItem::test_id>(ColumnEncoding::frame_of_reference);
+        writer.setEncoding<&TestItem::test_foot>(ColumnEncoding::delta);
+        CHECK_THROWS(writer.setEncoding<&TestItem::test_float>(ColumnEncoding::delta));
+        writer.write(items.data(), 500);
+    }
+    file.close();
+
+    file.open(OpenMode::readonly);
+    ColumnReader<TestItemFields> reader(file);
+    std::vector<TestItem> rows;
+    reader.readRows(2, rows);
+    CHECK(rows.size() == 100);
+    CHECK(rows[50].test_id == items[450].test_id);
+    CHECK(rows[50].test_long == items[450].test_long);
+    CHECK(rows[50].test_foot[0] == 450);
+    CHECK(rows[50].test_foot[5] == 15001);
+    CHECK(reader.readColumn<&TestItem::test_long>(0)[199] == times[199]);
+}
+
+TEST_CASE("Verify float series") {
+    std::string file_name = "float_series_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    // bit fields of every width come back in order
+    std::vector<unsigned char> bytes;
+    BitWriter writer(bytes);
+    for (int count = 0; count <= 64; ++count)
+        writer.put(0xF0E1D2C3B4A59687ull, count);
+    writer.putBit(true);
+    writer.finish();
+    CHECK(writer.getBitCount() == 64 * 65 / 2 + 1);
+    CHECK(static_cast<int64_t>(bytes.size()) == (writer.getBitCount() + 7) / 8);
+
+    BitReader reader(bytes.data(), static_cast<int64_t>(bytes.size()));
+    bool fields_match = true;
+    for (int count = 0; count <= 64; ++count) {
+        uint64_t expected = count == 64 ? 0xF0E1D2C3B4A59687ull : 0xF0E1D2C3B4A59687ull & ((1ull << count) - 1);
+        fields_match = fields_match && reader.get(count) == expected;
+    }
+    CHECK(fields_match);
+    CHECK(reader.getBit());
+    CHECK(!reader.overrun());
+    CHECK(reader.getBitsLeft() < 8);
+    reader.get(16);
+    CHECK(reader.overrun());
+
+    // wide fields are read high half first
+    bytes.clear();
+    BitWriter wide_writer(bytes);
+    wide_writer.put(0x0123456789ABCDEFull, 64);
+    wide_writer.put(0x1FEDCBA987654321ull, 61);
+    wide_writer.finish();
+    BitReader wide_reader(bytes.data(), static_cast<int64_t>(bytes.size()));
+    CHECK(wide_reader.get(64) == 0x0123456789ABCDEFull);
+    CHECK(wide_reader.get(61) == 0x1FEDCBA987654321ull);
+
+    // slowly changing sensor readings
+    std::vector<float> temps(20000);
+    std::vector<double> pressures(20000);
+    int step = 0;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 10 == 0)
+            step += (i * 7919) % 3 - 1;
+        temps[i] = 20.0f + step * 0.5f;
+        pressures[i] = 1013.25 + (i / 25) * 0.25;
+    }
+    temps[5] = -0.0f;
+    temps[6] = std::numeric_limits<float>::infinity();
+    temps[7] = std::numeric_limits<float>::quiet_NaN();
+
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.writeFloatSeries(temps.data(), 20000);
+    int64_t temps_size = file.getWritePos();
+    file.writeFloatSeries(pressures.data(), 20000);
+    int64_t pressures_size = file.getWritePos() - temps_size;
+    CHECK(temps_size * 5 < 4 * 20000);
+    CHECK(pressures_size * 5 < 8 * 20000);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    std::vector<float> read_temps(20000);
+    std::vector<double> read_pressures(20000);
+    file.readFloatSeries(read_temps.data(), 20000);
+    file.readFloatSeries(read_pressures.data(), 20000, temps_size);
+    CHECK(std::memcmp(read_temps.data(), temps.data(), 4 * 20000) == 0);
+    CHECK(read_pressures == pressures);
+    CHECK(std::signbit(read_temps[5]));
+    CHECK(std::isnan(read_temps[7]));
+    read_temps.resize(20001);
+    CHECK_THROWS_AS(file.readFloatSeries(read_temps.data(), 20001, 0), std::runtime_error);
+    file.close();
+}
+
+TEST_CASE("Verify dictionary encoded strings") {
+    std::string file_name = "dictionary_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    const char *cities[] = {"Honolulu", "Hilo", "Kailua", "Pearl City", "Waipahu", ""};
+    std::vector<TestItem> items(5000);
+    for (int i = 0; i < 5000; ++i) {
+        items[i].test_id = i;
+        items[i].test_str = cities[(i * 7) % 6];
+    }
+
+    // the same rows with plain and dictionary encoded strings
+    int64_t sizes[2];
+    for (int dictionary = 0; dictionary < 2; ++dictionary) {
+        std::filesystem::remove(file_path + file_name);
+        DataFile file(file_name, file_path, OpenMode::overwrite);
+        {
+            ColumnWriter<TestItemFields> writer(file, 2000);
+            if (dictionary)
+                writer.setEncoding<&TestItem::test_str>(ColumnEncoding::dictionary);
+            CHECK_THROWS(writer.setEncoding<&TestItem::test_id>(ColumnEncoding::dictionary));
+            CHECK_THROWS(writer.setEncoding<&TestItem::test_str>(ColumnEncoding::delta));
+            writer.write(items.data(), 5000);
+        }
+        sizes[dictionary] = file.getFileSize();
+        file.close();
+
+        file.open(OpenMode::readonly);
+        ColumnReader<TestItemFields> reader(file);
+        bool views_match = true;
+        int64_t row = 0;
+        for (int64_t g = 0; g < reader.getRowGroupCount(); ++g) {
+            for (std::string_view view : reader.readStrings<&TestItem::test_str>(g))
+                views_match = views_match && view == items[row++].test_str;
+        }
+        CHECK(views_match);
+        CHECK(row == 5000);
+
+        std::span<const std::string_view> views = reader.readStrings<&TestItem::test_str>(1);
+        CHECK(views[3] == items[2003].test_str);
+        std::span<const std::string> strs = reader.readColumn<&TestItem::test_str>(1);
+        CHECK(strs[3] == items[2003].test_str);
+
+        std::vector<TestItem> rows;
+        reader.readRows(2, rows);
+        CHECK(rows.size() == 1000);
+        CHECK(rows[999].test_str == items[4999].test_str);
+        CHECK(rows[999].test_id == 4999);
+        file.close();
+    }
+    // the string column shrinks to a few bits per row
+    int64_t string_bytes = 0;
+    for (const TestItem &item : items)
+        string_bytes += 2 + static_cast<int64_t>(item.test_str.size());
+    CHECK(sizes[0] - sizes[1] > string_bytes * 8 / 10);
+}
+
+TEST_CASE("Verify varint arrays") {
+    std::string file_name = "varint_array_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    // every byte length, in every lane, including a partial last control byte
+    std::vector<uint32_t> values(1003);
+    const uint32_t samples[] = {0, 0xFF, 0x100, 0xFFFF, 0x10000, 0xFFFFFF, 0x1000000, 0xFFFFFFFF, 7};
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = samples[(i * 5) % 9];
+
+    std::vector<unsigned char> encoded;
+    StreamVByte::encode(values.data(), 1003, encoded);
+    encoded.resize(encoded.size() + StreamVByte::padding);
+    int64_t size = static_cast<int64_t>(encoded.size()) - StreamVByte::padding;
+    std::vector<uint32_t> decoded(1003);
+    CHECK(StreamVByte::decode(encoded.data(), size, decoded.data(), 1003));
+    CHECK(decoded == values);
+    CHECK(!StreamVByte::decode(encoded.data(), size - 1, decoded.data(), 1003));
+
+    // small counts and ids, signed values near zero and narrow types
+    std::vector<uint32_t> counts(10000);
+    std::vector<int32_t> offsets(10000);
+    std::vector<int16_t> shorts(1001);
+    for (int i = 0; i < 10000; ++i) {
+        counts[i] = (i * 7919) % 200;
+        offsets[i] = (i * 31) % 255 - 127;
+    }
+    for (int i = 0; i < 1001; ++i)
+        shorts[i] = static_cast<int16_t>(i * 97 - 30000);
+
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.writeVarintArray(counts.data(), 10000);
+    int64_t counts_size = file.getWritePos();
+    file.writeVarintArray(offsets.data(), 10000);
+    int64_t offsets_size = file.getWritePos() - counts_size;
+    file.writeVarintArray(shorts.data(), 1001);
+    // a byte per value plus a control byte per 4 values
+    CHECK(counts_size == 8 + 10000 + 2500);
+    CHECK(offsets_size == 8 + 10000 + 2500);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    std::vector<uint32_t> read_counts(10000);
+    std::vector<int32_t> read_offsets(10000);
+    std::vector<int16_t> read_shorts(1001);
+    file.readVarintArray(read_counts.data(), 10000);
+    file.readVarintArray(read_offsets.data(), 10000, counts_size);
+    file.readVarintArray(read_shorts.data(), 1001);
+    CHECK(read_counts == counts);
+    CHECK(read_offsets == offsets);
+    CHECK(read_shorts == shorts);
+    read_counts.resize(10001);
+    CHECK_THROWS_AS(file.readVarintArray(read_counts.data(), 10001, 0), std::runtime_error);
+
+    // an 8-bit read of values that do not fit
+    std::vector<int8_t> bytes(1001);
+    CHECK_THROWS_AS(file.readVarintArray(bytes.data(), 1001, counts_size + offsets_size), std::runtime_error);
+    file.close();
+}
+
+TEST_CASE("Verify bit streams on files") {
+    std::string file_name = "bit_stream_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+    std::filesystem::remove(file_path + file_name);
+
+    // a flag, a 3-bit kind and a 12-bit length per entry, then a payload
+    // that starts on a byte boundary or in the middle of a byte
+    std::vector<unsigned char> payload(100000);
+    for (size_t i = 0; i < payload.size(); ++i)
+        payload[i] = static_cast<unsigned char>(i * 131 + i / 7);
+    const int64_t lengths[] = {0, 5, 16, 40000, 70000, 3};
+
+    int32_t marker = 0x5EA1;
+    DataFile file(file_name, file_path, OpenMode::overwrite);
+    file.write(&marker);
+    int64_t start = file.getWritePos();
+    BitWriter writer(file);
+    for (int entry = 0; entry < 6; ++entry) {
+        writer.putBit(entry % 2 == 1);
+        writer.put(entry, 3);
+        writer.put(static_cast<uint64_t>(lengths[entry]) & 0xFFF, 12);
+        if (entry % 3 == 0)
+            writer.padToByte();
+        writer.putBytes(payload.data() + entry, lengths[entry]);
+    }
+    for (int i = 0; i < 20000; ++i)
+        writer.put(static_cast<uint64_t>(i), 17);
+    writer.finish();
+    int64_t size = file.getWritePos() - start;
+    CHECK(size == (writer.getBitCount() + 7) / 8);
+    file.write(&marker);
+    file.close();
+
+    file.open(OpenMode::readonly);
+    int32_t read_marker = 0;
+    file.read(&read_marker);
+    BitReader reader(file, size);
+    bool entries_match = true;
+    std::vector<unsigned char> read_payload(payload.size());
+    for (int entry = 0; entry < 6; ++entry) {
+        entries_match = entries_match && reader.getBit() == (entry % 2 == 1);
+        entries_match = entries_match && reader.get(3) == static_cast<uint64_t>(entry);
+        entries_match = entries_match && reader.get(12) == (static_cast<uint64_t>(lengths[entry]) & 0xFFF);
+        if (entry % 3 == 0)
+            reader.skipToByte();
+        reader.getBytes(read_payload.data(), lengths[entry]);
+        entries_match = entries_match && std::memcmp(read_payload.data(), payload.data() + entry, lengths[entry]) == 0;
+    }
+    CHECK(entries_match);
+    bool fields_match = true;
+    for (int i = 0; i < 20000; ++i)
+        fields_match = fields_match && reader.get(17) == static_cast<uint64_t>(i);
+    CHECK(fields_match);
+    CHECK(!reader.overrun());
+    CHECK(reader.getBitsLeft() < 8);
+    reader.finish();
+    file.read(&read_marker);
+    CHECK(read_marker == marker);
+
+    // the reader stops at its size, leaving the next value for the file
+    file.setReadPos(start);
+    BitReader short_reader(file, 3);
+    short_reader.getBytes(read_payload.data(), 4);
+    CHECK(short_reader.overrun());
+    CHECK(read_payload[3] == 0);
+    CHECK(file.getReadPos() == start + 3);
+    file.close();
+}
+
+TEST_CASE("Verify zone maps") {
+    std::string file_name = "zone_map_test.bin";
+    std::string file_path = ".\\doctest\\data\\";
+
+    // clustered timestamps, so each row group covers a narrow range
+    std::vector<TestItem> items(20000);
+    for (int i = 0; i < 20000; ++i) {
+        items[i].test_id = i;
+        items[i].test_str = "item " + std::to_string(i % 100);
+        items[i].test_long = 1700000000000LL + 1000LL * i + (i * 7919) % 500;
+        items[i].test_float = (i % 1000 == 0) ? std::numeric_limits<float>::quiet_NaN() : i * 0.25f;
+    }
+
+    for (int zone_maps = 0; zone_maps < 2; ++zone_maps) {
+        std::filesystem::remove(file_path + file_name);
+        DataFile file(file_name, file_path, OpenMode::overwrite);
+        {
+            ColumnWriter<TestItemFields> writer(file, 1000);
+            if (zone_maps)
+                writer.enableZoneMaps();
+            writer.setEncoding<&TestItem::test_long>(ColumnEncoding::delta);
+            writer.write(items.data(), 20000);
+            writer.finish();
+            CHECK_THROWS(writer.enableZoneMaps());
+        }
+        file.close();
+
+        file.open(OpenMode::readonly);
+        ColumnReader<TestItemFields> reader(file);
+        CHECK(reader.hasZoneMaps() == (zone_maps == 1));
+        CHECK(reader.getRowGroupCount() == 20);
+
+        // about 1.5 row groups worth of timestamps
+        long long low = items[4500].test_long;
+        long long high = items[5999].test_long;
+        std::vector<int64_t> groups = reader.findRowGroups<&TestItem::test_long>(low, high);
+        CHECK(groups.size() == (zone_maps ? 2u : 20u));
+
+        int64_t expected = 0;
+        for (const TestItem &item : items)
+            expected += (item.test_long >= low && item.test_long <= high) ? 1 : 0;
+        std::vector<unsigned int> ids;
+        int64_t visited = reader.scan<&TestItem::test_long>(low, high, [&](const TestItem &item) {
+            ids.push_back(item.test_id);
+        });
+        CHECK(visited == expected);
+        CHECK(static_cast<int64_t>(ids.size()) == expected);
+        bool rows_match = true;
+        for (unsigned int id : ids)
+            rows_match = rows_match && items[id].test_long >= low && items[id].test_long <= high &&
+                         std::to_string(id % 100) == items[id].test_str.substr(5);
+        CHECK(rows_match);
+        CHECK(reader.scan<&TestItem::test_long>(0, 1, [](const TestItem &) { }) == 0);
+
+        if (zone_maps) {
+            ColumnStats<long long> stats = reader.getStats<&TestItem::test_long>(3);
+            CHECK(stats.rows == 1000);
+            CHECK(stats.null_count == 0);
+            CHECK(stats.min == std::min_element(items.begin() + 3000, items.begin() + 4000, [](auto &a, auto &b) { return a.test_long < b.test_long; })->test_long);
+            CHECK(stats.max == std::max_element(items.begin() + 3000, items.begin() + 4000, [](auto &a, auto &b) { return a.test_long < b.test_long; })->test_long);
+
+            // NaN is a null and stays out of the range
+            ColumnStats<float> floats = reader.getStats<&TestItem::test_float>(2);
+            CHECK(floats.null_count == 1);
+            CHECK(floats.min == 2001 * 0.25f);
+            CHECK(floats.max == 2999 * 0.25f);
+            CHECK(reader.findRowGroups<&TestItem::test_float>(100.0f, 300.0f).size() == 2);
+        } else {
+            CHECK_THROWS_AS(reader.getStats<&TestItem::test_long>(0), std::runtime_error);
+        }
+        file.close();
+    }
+}
+
+TEST_CASE("Verify Bloom filters") {
+    std::string file_path = ".\\doctest\\data\\";
+
+    // no false negatives, few false positives, in memory
+    BloomFilter filter(10000);
+    for (int i = 0; i < 10000; ++i)
+        filter.add("key " + std::to_string(i));
+    bool all_found = true;
+    for (int i = 0; i < 10000; ++i)
+        all_found = all_found && filter.mayContain("key " + std::to_string(i));
+    CHECK(all_found);
+    int false_positives = 0;
+    for (int i = 10000; i < 20000; ++i)
+        false_positives += filter.mayContain("key " + std::to_string(i)) ? 1 : 0;
+    CHECK(false_positives < 300);
+    CHECK(filter.getKeyCount() == 10000);
+    CHECK(BloomFilter::hash("key 1") != BloomFilter::hash("key 2"));
+    CHECK(BloomFilter().mayContain("anything"));
+
+    // a few files with disjoint keys, written with their sidecars
+    std::vector<std::string> names = {"bloom_test_0.bin", "bloom_test_1.bin", "bloom_test_2.bin"};
+    for (size_t f = 0; f < names.size(); ++f) {
+        std::filesystem::remove(file_path + names[f]);
+        std::filesystem::remove(file_path + names[f] + ".bloom");
+        DataFile file;
+        file.setFilePath(file_path);
+        file.setFileName(names[f]);
+        CHECK_THROWS_AS(file.enableBloomFilter(0), std::invalid_argument);
+        file.enableBloomFilter(1000);
+        file.open(OpenMode::overwrite);
+        CHECK(file.hasBloomFilter());
+        for (int i = 0; i < 1000; ++i) {
+            TestItem item("user " + std::to_string(f * 1000 + i), i, 0.0f);
+            item.serialize(file);
+            file.addKey(item.test_str);
+        }
+        file.close();
+        CHECK(std::filesystem::exists(file_path + names[f] + ".bloom"));
+    }
+
+    // a lookup opens only the files whose filter allows the key; readers
+    // load the saved filter whatever size they ask for
+    std::vector<DataFile> files;
+    for (const std::string &name : names) {
+        DataFile file;
+        file.setFilePath(file_path);
+        file.setFileName(name);
+        file.enableBloomFilter();
+        file.open(OpenMode::readonly);
+        CHECK(file.hasBloomFilter());
+        file.close();
+        files.push_back(std::move(file));
+    }
+    int candidates = 0;
+    for (DataFile &file : files)
+        candidates += file.mayContainKey("user 1234") ? 1 : 0;
+    CHECK(files[1].mayContainKey("user 1234"));
+    CHECK(candidates < 3);
+    int rejected = 0;
+    for (int i = 3000; i < 4000; ++i)
+        for (DataFile &file : files)
+            rejected += file.mayContainKey("user " + std::to_string(i)) ? 0 : 1;
+    CHECK(rejected > 3 * 1000 * 95 / 100);
+
+    // keys added while editing are kept; a sidecar that is out of date is not used
+    files[0].open(OpenMode::edit);
+    files[0].setWritePosEnd();
+    TestItem extra("user extra", 1, 0.0f);
+    extra.serialize(files[0]);
+    files[0].addKey(extra.test_str);
+    files[0].close();
+    files[0].open(OpenMode::readonly);
+    CHECK(files[0].mayContainKey("user extra"));
+    files[0].close();
+
+    std::filesystem::copy_file(file_path + names[2] + ".bloom", file_path + names[0] + ".bloom",
+                               std::filesystem::copy_options::overwrite_existing);
+    {
+        std::ofstream grow(file_path + names[0], std::ios::binary | std::ios::app);
+        grow.put(0);
+    }
+    files[0].open(OpenMode::readonly);
+    CHECK(!files[0].hasBloomFilter());
+    CHECK(files[0].mayContainKey("user 5"));
+    files[0].close();
+
+    // a sidecar whose block count does not match its size is not loaded
+    std::string sidecar = file_path + names[1] + ".bloom";
+    int64_t data_size = static_cast<int64_t>(std::filesystem::file_size(file_path + names[1]));
+    BloomFilter loaded;
+    CHECK(loaded.load(sidecar, data_size));
+    {
+        std::fstream damage(sidecar, std::ios::binary | std::ios::in | std::ios::out);
+        damage.seekp(8);
+        const char count[8] = {0, 0, 0, 0, 0, 0, 0, 0x10};
+        damage.write(count, 8);
+    }
+    CHECK(!loaded.load(sidecar, data_size));
+    CHECK(loaded.mayContain("user 1234"));
+}
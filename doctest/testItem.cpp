@@ -13,11 +13,7 @@ TestItem::TestItem(std::string new_str, long long new_long, float new_float):
 
 
 void TestItem::serialize(DataFile &file){
-    file.write(&test_id);
-    file.write(test_str);
-    file.write(&test_long);
-    file.write(&test_float);
-    file.writeArray(test_foot, foot_len);
+    TestItemFields::serialize(file, *this);
 }
 
 void TestItem::serialize(DataFile &file, long long pos) {
@@ -26,11 +22,7 @@ void TestItem::serialize(DataFile &file, long long pos) {
 }
 
 void TestItem::deserialize(DataFile &file) {
-    file.read(&test_id);
-    file.read(test_str);
-    file.read(&test_long);
-    file.read(&test_float);
-    file.readArray(test_foot, foot_len);
+    TestItemFields::deserialize(file, *this);
 }
 
 void TestItem::deserialize(DataFile &file, long long pos) {
@@ -39,8 +31,7 @@ void TestItem::deserialize(DataFile &file, long long pos) {
 }
 
 int TestItem::getSize() {
-    return sizeof(test_id) + 2 + test_str.length() + sizeof(test_long) +
-           sizeof(test_float) + sizeof(test_foot);
+    return static_cast<int>(TestItemFields::size(*this));
 }
 
 
@@ -58,9 +49,9 @@ std::string TestItem::toString() {
     std::stringstream ss;
 
     ss << std::hex << std::uppercase << std::setfill('0')
-       << "Test ID:     0x" << std::setw(8) << _byteswap_ulong(test_id) << "\n"
+       << "Test ID:     0x" << std::setw(8) << ByteSwap::swap32(test_id) << "\n"
        << "Test String: \"" << test_str << "\"\n"
-       << "Test Long:   0x" << std::setw(16) << _byteswap_uint64(test_long) << "\n"
+       << "Test Long:   0x" << std::setw(16) << ByteSwap::swap64(test_long) << "\n"
        << "Test Float:  " << std::to_string(test_float) << "\n"
        << "Test Footer: " << footer_str.str() << "\n\n";
     
@@ -3,7 +3,9 @@
 #ifndef TEST_ITEM_H
 #define TEST_ITEM_H
 
+#include "..\src\ByteSwap.h"
 #include "..\src\DataFile.h"
+#include "..\src\Record.h"
 #include <string>
 #include <vector>
 #include <sstream>
@@ -32,5 +34,12 @@ struct TestItem {
 
 };
 
+// file layout of a TestItem
+using TestItemFields = RecordFields<&TestItem::test_id,
+                                    &TestItem::test_str,
+                                    &TestItem::test_long,
+                                    &TestItem::test_float,
+                                    &TestItem::test_foot>;
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+
+#include "BitPack.h"
+
+#include <array>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+#if defined(__SSE2__)
+    // The kernels are generated for every width, so each shift is a
+    // constant and the 32 steps unroll into straight-line code.
+    template<int W>
+    void pack128Width(const uint32_t *in, unsigned char *out) {
+        const __m128i *ip = reinterpret_cast<const __m128i*>(in);
+        __m128i *op = reinterpret_cast<__m128i*>(out);
+        __m128i acc = _mm_setzero_si128();
+        int shift = 0;
+
+        for (int j = 0; j < 32; ++j) {
+            __m128i value = _mm_loadu_si128(ip + j);
+            acc = _mm_or_si128(acc, _mm_slli_epi32(value, shift));
+            shift += W;
+            if (shift >= 32) {
+                _mm_storeu_si128(op++, acc);
+                shift -= 32;
+                // the bits that did not fit start the next word
+                acc = shift > 0 ? _mm_srli_epi32(value, W - shift) : _mm_setzero_si128();
+            }
+        }
+    }
+
+    template<int W>
+    void unpack128Width(const unsigned char *in, uint32_t *out) {
+        const __m128i *ip = reinterpret_cast<const __m128i*>(in);
+        __m128i *op = reinterpret_cast<__m128i*>(out);
+        const __m128i mask = _mm_set1_epi32(W == 32 ? -1 : static_cast<int>((1u << W) - 1));
+        __m128i word = _mm_loadu_si128(ip++);
+        int shift = 0;
+
+        for (int j = 0; j < 32; ++j) {
+            __m128i value = _mm_srli_epi32(word, shift);
+            shift += W;
+            if (shift >= 32) {
+                shift -= 32;
+                if (j < 31)
+                    word = _mm_loadu_si128(ip++);
+                // the high bits of the value start the next word
+                if (shift > 0)
+                    value = _mm_or_si128(value, _mm_slli_epi32(word, W - shift));
+            }
+            _mm_storeu_si128(op + j, _mm_and_si128(value, mask));
+        }
+    }
+
+    using Pack128 = void (*)(const uint32_t*, unsigned char*);
+    using Unpack128 = void (*)(const unsigned char*, uint32_t*);
+
+    template<size_t... W>
+    constexpr std::array<Pack128, sizeof...(W)> packTable(std::index_sequence<W...>) {
+        return {{&pack128Width<static_cast<int>(W + 1)>...}};
+    }
+
+    template<size_t... W>
+    constexpr std::array<Unpack128, sizeof...(W)> unpackTable(std::index_sequence<W...>) {
+        return {{&unpack128Width<static_cast<int>(W + 1)>...}};
+    }
+
+    // kernels for widths 1 to 32
+    constexpr std::array<Pack128, 32> pack_kernels = packTable(std::make_index_sequence<32>());
+    constexpr std::array<Unpack128, 32> unpack_kernels = unpackTable(std::make_index_sequence<32>());
+#endif
+
+    // little-endian helpers for the one-after-another layout
+    void putWord(unsigned char *out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i)
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    uint64_t getWord(const unsigned char *in, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        return value;
+    }
+}
+
+/***** 4 LANE LAYOUT *****/
+
+void BitPack::pack128(const uint32_t *in, int width, unsigned char *out) {
+    if (width == 0)
+        return;
+#if defined(__SSE2__)
+    pack_kernels[width - 1](in, out);
+#else
+    // the same layout one lane at a time
+    for (int lane = 0; lane < 4; ++lane) {
+        uint64_t acc = 0;
+        int filled = 0;
+        int word = 0;
+        for (int j = 0; j < 32; ++j) {
+            acc |= static_cast<uint64_t>(in[4 * j + lane]) << filled;
+            filled += width;
+            if (filled >= 32) {
+                putWord(out + 16 * word + 4 * lane, acc, 4);
+                ++word;
+                acc >>= 32;
+                filled -= 32;
+            }
+        }
+    }
+#endif
+}
+
+void BitPack::unpack128(const unsigned char *in, int width, uint32_t *out) {
+    if (width == 0) {
+        std::fill(out, out + block_size, 0u);
+        return;
+    }
+#if defined(__SSE2__)
+    unpack_kernels[width - 1](in, out);
+#else
+    uint64_t mask = (width == 32) ? 0xFFFFFFFFull : ((1ull << width) - 1);
+    for (int lane = 0; lane < 4; ++lane) {
+        uint64_t acc = 0;
+        int avail = 0;
+        int word = 0;
+        for (int j = 0; j < 32; ++j) {
+            if (avail < width) {
+                acc |= getWord(in + 16 * word + 4 * lane, 4) << avail;
+                ++word;
+                avail += 32;
+            }
+            out[4 * j + lane] = static_cast<uint32_t>(acc & mask);
+            acc >>= width;
+            avail -= width;
+        }
+    }
+#endif
+}
+
+void BitPack::undelta128(uint32_t *values, uint32_t &prev) {
+#if defined(__SSE2__)
+    __m128i *vp = reinterpret_cast<__m128i*>(values);
+    __m128i carry = _mm_set1_epi32(static_cast<int>(prev));
+    const __m128i one = _mm_set1_epi32(1);
+    for (int j = 0; j < 32; ++j) {
+        // zigzag decode, then a prefix sum over the 4 neighbours
+        __m128i zigzag = _mm_loadu_si128(vp + j);
+        __m128i diff = _mm_xor_si128(_mm_srli_epi32(zigzag, 1),
+                                     _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag, one)));
+        diff = _mm_add_epi32(diff, _mm_slli_si128(diff, 4));
+        diff = _mm_add_epi32(diff, _mm_slli_si128(diff, 8));
+        carry = _mm_add_epi32(diff, carry);
+        _mm_storeu_si128(vp + j, carry);
+        carry = _mm_shuffle_epi32(carry, 0xFF);
+    }
+    prev = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+#else
+    for (int64_t i = 0; i < block_size; ++i) {
+        uint32_t zigzag = values[i];
+        prev += (zigzag >> 1) ^ (0u - (zigzag & 1));
+        values[i] = prev;
+    }
+#endif
+}
+
+/***** ONE AFTER ANOTHER *****/
+
+void BitPack::pack(const uint64_t *in, int64_t len, int width, unsigned char *out) {
+    if (width == 0)
+        return;
+
+    uint64_t acc = 0;
+    int filled = 0;     // bits in acc, always below 64
+    for (int64_t i = 0; i < len; ++i) {
+        acc |= in[i] << filled;
+        if (filled + width >= 64) {
+            putWord(out, acc, 8);
+            out += 8;
+            int used = 64 - filled;
+            acc = used < 64 ? in[i] >> used : 0;
+            filled += width - 64;
+        } else {
+            filled += width;
+        }
+    }
+    putWord(out, acc, (filled + 7) / 8);
+}
+
+void BitPack::unpack(const unsigned char *in, int64_t len, int width, uint64_t *out) {
+    if (width == 0) {
+        std::fill(out, out + len, 0ull);
+        return;
+    }
+
+    const unsigned char *end = in + packedSize(len, width);
+    uint64_t mask = (width == 64) ? ~0ull : ((1ull << width) - 1);
+    uint64_t acc = 0;
+    int avail = 0;      // bits left in acc, always below 64
+    for (int64_t i = 0; i < len; ++i) {
+        if (avail >= width) {
+            out[i] = acc & mask;
+            acc >>= width;
+            avail -= width;
+            continue;
+        }
+
+        // take the rest of the value from the next word
+        int bytes = static_cast<int>(std::min<int64_t>(8, end - in));
+        uint64_t next = getWord(in, bytes);
+        in += bytes;
+        int need = width - avail;
+        out[i] = (acc | (next << avail)) & mask;
+        acc = need < 64 ? next >> need : 0;
+        avail = 8 * bytes - need;
+    }
+}
@@ -0,0 +1,260 @@
+/**
+ * @file BitPack.h
+ * @author Danielle Fukunaga
+ * @brief Delta, zigzag and frame-of-reference encodings for integer arrays,
+ *        stored as bit-packed blocks of 128 values.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef BIT_PACK_H
+#define BIT_PACK_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+
+/**
+ * @brief How DataFile::writePackedArray turns integers into small numbers
+ *        before bit-packing them.
+ *
+ * - delta              = zigzag encoded differences between neighbours, for
+ *                        sorted or slowly changing values such as timestamps
+ *
+ * - frame_of_reference = offsets from the smallest value of each block, for
+ *                        values in a small range
+ *
+ */
+enum class IntEncoding : uint8_t {
+    delta = 1,
+    frame_of_reference = 2
+};
+
+/**
+ * @brief Bit-packing kernels and the packed array format.
+ *
+ * A packed array starts with its IntEncoding byte, followed by one entry per
+ * block of up to 128 values:
+ *
+ * - uint8_t bit width
+ *
+ * - T base, little-endian (frame_of_reference only)
+ *
+ * - the packed values
+ *
+ * Full blocks with a width of at most 32 bits are packed 4 values across:
+ * value i goes to lane i % 4, and each lane packs its 32 values into width
+ * 32-bit words, least significant bits first. The words of the 4 lanes are
+ * interleaved, so one 128-bit vector holds the same word of every lane and
+ * unpacking is a few shifts and masks per 4 values (16 * width bytes per
+ * block). Other blocks are packed one after another, least significant bits
+ * first, in (count * width + 7) / 8 bytes.
+ *
+ * The packed bytes are the same on every host.
+ *
+ */
+namespace BitPack {
+    constexpr int64_t               block_size = 128;
+
+    // Packs 128 values of at most width bits in the 4 lane layout, writing
+    // 16 * width bytes.
+    void                            pack128(const uint32_t *in, int width, unsigned char *out);
+    // Unpacks 128 values written by pack128.
+    void                            unpack128(const unsigned char *in, int width, uint32_t *out);
+    // Packs len values of at most width bits one after another.
+    void                            pack(const uint64_t *in, int64_t len, int width, unsigned char *out);
+    // Unpacks len values written by pack.
+    void                            unpack(const unsigned char *in, int64_t len, int width, uint64_t *out);
+    // Replaces 128 zigzag encoded differences with the running sum, starting
+    // from prev. prev becomes the last value.
+    void                            undelta128(uint32_t *values, uint32_t &prev);
+
+    // Returns the number of bits needed for value.
+    inline int                      width(uint64_t value) { return 64 - std::countl_zero(value); }
+
+    // Returns the number of bytes pack() writes.
+    inline int64_t                  packedSize(int64_t len, int width) { return (len * width + 7) / 8; }
+
+    // Returns the largest packed size of len values of T.
+    template<typename T>
+    int64_t                         maxPackedSize(int64_t len);
+
+    template<typename T>
+    void                            encode(const T *data, int64_t len, IntEncoding encoding, std::vector<unsigned char> &out);
+    template<typename T>
+    bool                            decode(const unsigned char *in, int64_t size, T *data, int64_t len);
+}
+
+/***** PACKED ARRAYS *****/
+
+namespace BitPackDetail {
+    // integers that can be packed, including plain char
+    template<typename T> constexpr bool is_packable = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+    template<typename T>
+    void putBase(unsigned char *out, T value) {
+        auto bits = static_cast<std::make_unsigned_t<T>>(value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+            out[i] = static_cast<unsigned char>(static_cast<uint64_t>(bits) >> (8 * i));
+    }
+
+    template<typename T>
+    T getBase(const unsigned char *in) {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+        return static_cast<T>(static_cast<std::make_unsigned_t<T>>(bits));
+    }
+}
+
+template<typename T>
+int64_t BitPack::maxPackedSize(int64_t len) {
+    int64_t blocks = (len + block_size - 1) / block_size;
+    return 1 + blocks * (1 + static_cast<int64_t>(sizeof(T))) + len * static_cast<int64_t>(sizeof(T));
+}
+
+// Appends the packed form of len values to out.
+template<typename T>
+void BitPack::encode(const T *data, int64_t len, IntEncoding encoding, std::vector<unsigned char> &out) {
+    static_assert(BitPackDetail::is_packable<T>, "Only integers can be packed.");
+    using U = std::make_unsigned_t<T>;
+    using S = std::make_signed_t<T>;
+    constexpr int bits = 8 * sizeof(T);
+
+    size_t start = out.size();
+    out.resize(start + static_cast<size_t>(maxPackedSize<T>(len)));
+    unsigned char *op = out.data() + start;
+    *op++ = static_cast<unsigned char>(encoding);
+
+    uint64_t values[block_size];
+    uint32_t narrow[block_size];
+    U prev = 0;
+    for (int64_t first = 0; first < len; first += block_size) {
+        int64_t count = std::min(block_size, len - first);
+        const T *block = data + first;
+
+        // turn the block into small unsigned numbers
+        U base = 0;
+        if (encoding == IntEncoding::delta) {
+            for (int64_t i = 0; i < count; ++i) {
+                S diff = static_cast<S>(static_cast<U>(static_cast<U>(block[i]) - prev));
+                values[i] = static_cast<U>(static_cast<U>(static_cast<U>(diff) << 1) ^ static_cast<U>(diff >> (bits - 1)));
+                prev = static_cast<U>(block[i]);
+            }
+        } else {
+            T low = *std::min_element(block, block + count);
+            base = static_cast<U>(low);
+            for (int64_t i = 0; i < count; ++i)
+                values[i] = static_cast<U>(static_cast<U>(block[i]) - base);
+        }
+
+        uint64_t all = 0;
+        for (int64_t i = 0; i < count; ++i)
+            all |= values[i];
+        int block_width = width(all);
+
+        *op++ = static_cast<unsigned char>(block_width);
+        if (encoding == IntEncoding::frame_of_reference) {
+            BitPackDetail::putBase(op, static_cast<T>(base));
+            op += sizeof(T);
+        }
+        if (count == block_size && block_width <= 32) {
+            for (int64_t i = 0; i < block_size; ++i)
+                narrow[i] = static_cast<uint32_t>(values[i]);
+            pack128(narrow, block_width, op);
+            op += 16 * block_width;
+        } else {
+            pack(values, count, block_width, op);
+            op += packedSize(count, block_width);
+        }
+    }
+
+    out.resize(static_cast<size_t>(op - out.data()));
+}
+
+// Decodes size packed bytes into len values. Returns false if the bytes are
+// not a packed array of exactly len values of T.
+template<typename T>
+bool BitPack::decode(const unsigned char *in, int64_t size, T *data, int64_t len) {
+    static_assert(BitPackDetail::is_packable<T>, "Only integers can be packed.");
+    using U = std::make_unsigned_t<T>;
+    constexpr int bits = 8 * sizeof(T);
+
+    const unsigned char *const end = in + size;
+    if (size < 1)
+        return false;
+    IntEncoding encoding = static_cast<IntEncoding>(*in++);
+    if (encoding != IntEncoding::delta && encoding != IntEncoding::frame_of_reference)
+        return false;
+    bool delta = encoding == IntEncoding::delta;
+
+    uint64_t values[block_size];
+    uint32_t narrow[block_size];
+    U prev = 0;
+    for (int64_t first = 0; first < len; first += block_size) {
+        int64_t count = std::min(block_size, len - first);
+        T *block = data + first;
+
+        if (end - in < (delta ? 1 : 1 + static_cast<int64_t>(sizeof(T))))
+            return false;
+        int block_width = *in++;
+        if (block_width > bits)
+            return false;
+        U base = 0;
+        if (!delta) {
+            base = static_cast<U>(BitPackDetail::getBase<T>(in));
+            in += sizeof(T);
+        }
+
+        if (count == block_size && block_width <= 32) {
+            if (end - in < 16 * block_width)
+                return false;
+            unpack128(in, block_width, narrow);
+            in += 16 * block_width;
+
+            if constexpr (sizeof(T) <= 4) {
+                // work in 32 bits, the low bits are the same
+                if (delta) {
+                    uint32_t carry = static_cast<uint32_t>(prev);
+                    undelta128(narrow, carry);
+                    prev = static_cast<U>(carry);
+                } else {
+                    for (int64_t i = 0; i < block_size; ++i)
+                        narrow[i] += static_cast<uint32_t>(base);
+                }
+                for (int64_t i = 0; i < block_size; ++i)
+                    block[i] = static_cast<T>(static_cast<U>(narrow[i]));
+                continue;
+            }
+            for (int64_t i = 0; i < block_size; ++i)
+                values[i] = narrow[i];
+        } else {
+            if (end - in < packedSize(count, block_width))
+                return false;
+            unpack(in, count, block_width, values);
+            in += packedSize(count, block_width);
+        }
+
+        if (delta) {
+            for (int64_t i = 0; i < count; ++i) {
+                U zigzag = static_cast<U>(values[i]);
+                prev = static_cast<U>(prev + static_cast<U>(static_cast<U>(zigzag >> 1) ^ static_cast<U>(0 - (zigzag & 1))));
+                block[i] = static_cast<T>(prev);
+            }
+        } else {
+            for (int64_t i = 0; i < count; ++i)
+                block[i] = static_cast<T>(static_cast<U>(base + static_cast<U>(values[i])));
+        }
+    }
+
+    return in == end;
+}
+
+
+#endif
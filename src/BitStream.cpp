@@ -0,0 +1,115 @@
+
+#include "BitStream.h"
+#include "DataFile.h"
+
+#include <cstring>
+
+/***** BIT WRITER *****/
+
+// Writes len bytes as 8-bit fields. When the writer is on a byte boundary the
+// bytes are copied as they are, and a long run on a DataFile goes straight to
+// writeArray.
+void BitWriter::putBytes(const unsigned char *data, int64_t len) {
+    if (filled_ % 8 != 0) {
+        // 8 bytes per put while they last
+        int64_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t word = 0;
+            for (int b = 0; b < 8; ++b)
+                word = (word << 8) | data[i + b];
+            put(word, 64);
+        }
+        for (; i < len; ++i)
+            put(data[i], 8);
+        return;
+    }
+
+    storePending();
+    bits_ += 8 * len;
+    if (file_ != nullptr && len >= chunk_size) {
+        flushChunk();
+        file_->writeArray(data, len);
+        return;
+    }
+    out_->insert(out_->end(), data, data + len);
+    if (file_ != nullptr && static_cast<int64_t>(chunk_.size()) >= chunk_size)
+        flushChunk();
+}
+
+void BitWriter::flushChunk() {
+    if (chunk_.empty())
+        return;
+    file_->writeArray(chunk_.data(), static_cast<int64_t>(chunk_.size()));
+    chunk_.clear();
+}
+
+/***** BIT READER *****/
+
+// Reads len bytes as 8-bit fields. When the reader is on a byte boundary the
+// bytes are copied as they are, and a long run on a DataFile is read straight
+// into data.
+void BitReader::getBytes(unsigned char *data, int64_t len) {
+    if (avail_ % 8 != 0) {
+        for (int64_t i = 0; i < len; ++i)
+            data[i] = static_cast<unsigned char>(get(8));
+        return;
+    }
+
+    // the whole bytes already in the accumulator come first
+    while (len > 0 && avail_ > 0) {
+        *data++ = static_cast<unsigned char>(get(8));
+        --len;
+    }
+    if (len == 0)
+        return;
+    // bits past avail_ belong to bytes that are about to be skipped
+    acc_ = 0;
+
+    while (len > 0) {
+        if (next_ == end_) {
+            if (unread_ == 0)
+                break;
+            if (len >= chunk_size) {
+                int64_t direct = std::min(len, unread_);
+                file_->readArray(data, direct);
+                unread_ -= direct;
+                data += direct;
+                len -= direct;
+                continue;
+            }
+            loadChunk();
+        }
+        int64_t buffered = std::min<int64_t>(len, end_ - next_);
+        std::memcpy(data, next_, static_cast<size_t>(buffered));
+        next_ += buffered;
+        data += buffered;
+        len -= buffered;
+    }
+
+    // pad with zero bytes past the end
+    if (len > 0) {
+        std::memset(data, 0, static_cast<size_t>(len));
+        missing_ += 8 * len;
+    }
+}
+
+// Moves the file's read position past the bytes not read yet. The bits
+// already read into the reader can still be read.
+void BitReader::finish() {
+    if (file_ == nullptr || unread_ == 0)
+        return;
+    file_->setReadPos(file_->getReadPos() + unread_);
+    unread_ = 0;
+}
+
+// Moves the bytes not loaded into acc_ to the front of chunk_ and reads the
+// next bytes of the file after them.
+void BitReader::loadChunk() {
+    int64_t left = end_ - next_;
+    std::memmove(chunk_.data(), next_, static_cast<size_t>(left));
+    int64_t count = std::min(unread_, static_cast<int64_t>(chunk_.size()) - left);
+    file_->readArray(chunk_.data() + left, count);
+    unread_ -= count;
+    next_ = chunk_.data();
+    end_ = next_ + left + count;
+}
@@ -0,0 +1,275 @@
+/**
+ * @file BitStream.h
+ * @author Danielle Fukunaga
+ * @brief Bit-level writer and reader for formats that pack fields at
+ *        sub-byte granularity.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class DataFile;
+
+/**
+ * @brief Writes bit fields, most significant bit first, to a byte vector or
+ *        a DataFile.
+ *
+ * Bits collect in a 64-bit accumulator that is stored 8 bytes at a time, so
+ * put() is a shift and an or in the common case. Fields are written most
+ * significant bit first and bytes fill from their high bit, so the output
+ * reads the same on every host. finish() stores the last partial byte, padded
+ * with zero bits.
+ *
+ * A writer on a DataFile collects chunk_size bytes before passing them to
+ * writeArray, and writes them at the file's write position. Call finish()
+ * before using the file again.
+ *
+ */
+class BitWriter {
+public:
+    static constexpr int64_t        chunk_size = 64 * 1024;
+
+    explicit BitWriter(std::vector<unsigned char> &out);
+    explicit BitWriter(DataFile &file);
+    BitWriter(const BitWriter&) = delete;
+    BitWriter &operator=(const BitWriter&) = delete;
+
+    void                            put(uint64_t bits, int count);
+    void                            putBit(bool bit);
+    void                            putBytes(const unsigned char *data, int64_t len);
+    void                            padToByte();
+    void                            finish();
+
+    // getters/accessors
+
+    int64_t                         getBitCount() const;
+
+private:
+    void                            storeWord(uint64_t word);
+    void                            storePending();
+    void                            flushChunk();
+
+    std::vector<unsigned char>     *out_;
+    DataFile                       *file_;          // nullptr when writing to a vector
+    std::vector<unsigned char>      chunk_;         // bytes waiting for file_
+    uint64_t                        acc_;           // pending bits, left-aligned
+    int                             filled_;        // pending bits in acc_, always below 64
+    int64_t                         bits_;          // bits put so far
+
+};
+
+/**
+ * @brief Reads bit fields written by BitWriter.
+ *
+ * Bits are loaded into a 64-bit accumulator 8 bytes at a time while that many
+ * are left, so get() is a shift in the common case. Reading past the end
+ * returns zero bits and sets overrun().
+ *
+ * A reader on a DataFile reads the size bytes at the file's read position,
+ * chunk_size bytes at a time with readArray. finish() moves the read position
+ * to the end of those bytes.
+ *
+ */
+class BitReader {
+public:
+    static constexpr int64_t        chunk_size = 64 * 1024;
+
+    BitReader(const unsigned char *data, int64_t size);
+    BitReader(DataFile &file, int64_t size);
+    BitReader(const BitReader&) = delete;
+    BitReader &operator=(const BitReader&) = delete;
+
+    uint64_t                        get(int count);
+    bool                            getBit();
+    void                            getBytes(unsigned char *data, int64_t len);
+    void                            skipToByte();
+    void                            finish();
+
+    // getters/accessors
+
+    bool                            overrun() const;
+    int64_t                         getBitsLeft() const;
+
+private:
+    void                            refill();
+    void                            loadChunk();
+
+    const unsigned char            *next_;          // first byte not loaded into acc_
+    const unsigned char            *end_;
+    DataFile                       *file_;          // nullptr when reading from memory
+    std::vector<unsigned char>      chunk_;         // bytes read from file_
+    int64_t                         unread_;        // bytes of file_ not read into chunk_
+    uint64_t                        acc_;           // loaded bits, left-aligned
+    int                             avail_;         // valid bits in acc_
+    int64_t                         missing_;       // bits returned past the end
+
+};
+
+/***** BIT WRITER *****/
+
+inline BitWriter::BitWriter(std::vector<unsigned char> &out):
+    out_(&out),
+    file_(nullptr),
+    acc_(0),
+    filled_(0),
+    bits_(0) { }
+
+inline BitWriter::BitWriter(DataFile &file):
+    out_(&chunk_),
+    file_(&file),
+    acc_(0),
+    filled_(0),
+    bits_(0) {
+    chunk_.reserve(static_cast<size_t>(chunk_size + 8));
+}
+
+// Writes the low count bits of bits, most significant first. count is 0 to 64.
+inline void BitWriter::put(uint64_t bits, int count) {
+    if (count == 0)
+        return;
+    // the mask is all ones for count 64
+    bits &= ~0ull >> ((64 - count) & 63);
+    bits_ += count;
+
+    int free = 64 - filled_;
+    if (count < free) {
+        acc_ |= bits << (free - count);
+        filled_ += count;
+        return;
+    }
+
+    // fill the accumulator, store it and keep the rest
+    acc_ |= bits >> (count - free);
+    storeWord(acc_);
+    filled_ = count - free;
+    acc_ = filled_ > 0 ? bits << (64 - filled_) : 0;
+}
+
+inline void BitWriter::putBit(bool bit) { put(bit ? 1 : 0, 1); }
+
+// Writes zero bits up to the next byte boundary.
+inline void BitWriter::padToByte() { put(0, (8 - filled_ % 8) % 8); }
+
+// Stores the pending bits, padding the last byte with zeros. A writer on a
+// DataFile also writes the bytes it still holds.
+inline void BitWriter::finish() {
+    storePending();
+    if (file_ != nullptr)
+        flushChunk();
+}
+
+inline int64_t BitWriter::getBitCount() const { return bits_; }
+
+inline void BitWriter::storeWord(uint64_t word) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i)
+        bytes[i] = static_cast<unsigned char>(word >> (56 - 8 * i));
+    out_->insert(out_->end(), bytes, bytes + 8);
+    if (file_ != nullptr && static_cast<int64_t>(chunk_.size()) >= chunk_size)
+        flushChunk();
+}
+
+// Stores the whole and partial bytes in the accumulator.
+inline void BitWriter::storePending() {
+    for (int shift = 56; filled_ > 0; shift -= 8, filled_ -= 8)
+        out_->push_back(static_cast<unsigned char>(acc_ >> shift));
+    filled_ = 0;
+    acc_ = 0;
+}
+
+/***** BIT READER *****/
+
+inline BitReader::BitReader(const unsigned char *data, int64_t size):
+    next_(data),
+    end_(data + size),
+    file_(nullptr),
+    unread_(0),
+    acc_(0),
+    avail_(0),
+    missing_(0) { }
+
+// Nothing is read until the first get().
+inline BitReader::BitReader(DataFile &file, int64_t size):
+    next_(nullptr),
+    end_(nullptr),
+    file_(&file),
+    unread_(size),
+    acc_(0),
+    avail_(0),
+    missing_(0) {
+    chunk_.resize(static_cast<size_t>(std::min(size, chunk_size) + 8));
+    next_ = end_ = chunk_.data();
+}
+
+// Returns the next count bits as the low bits of the result. count is 0 to 64.
+inline uint64_t BitReader::get(int count) {
+    if (count > 56) {
+        // two statements, so the high half is read first on every compiler
+        uint64_t high = get(count - 32);
+        return (high << 32) | get(32);
+    }
+    if (count == 0)
+        return 0;
+
+    if (avail_ < count) {
+        refill();
+        if (avail_ < count) {
+            // pad with zero bits past the end
+            missing_ += count - avail_;
+            avail_ = count;
+        }
+    }
+
+    uint64_t bits = acc_ >> (64 - count);
+    acc_ <<= count;
+    avail_ -= count;
+    return bits;
+}
+
+inline bool BitReader::getBit() { return get(1) != 0; }
+
+// Skips the bits up to the next byte boundary.
+inline void BitReader::skipToByte() { get(avail_ % 8); }
+
+// Returns true if more bits were read than the data holds.
+inline bool BitReader::overrun() const { return missing_ > 0; }
+
+inline int64_t BitReader::getBitsLeft() const {
+    return avail_ - missing_ + 8 * (end_ - next_ + unread_);
+}
+
+// Loads whole bytes until at least 56 bits are available or the data ends.
+inline void BitReader::refill() {
+    if (end_ - next_ < 8 && unread_ > 0)
+        loadChunk();
+
+    if (end_ - next_ >= 8) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; ++i)
+            word = (word << 8) | next_[i];
+        int bytes = (63 - avail_) >> 3;
+        // only whole bytes count; the bits of the next byte that come along
+        // are loaded again at the same place by the next refill
+        acc_ |= word >> avail_;
+        next_ += bytes;
+        avail_ += 8 * bytes;
+        return;
+    }
+
+    while (avail_ <= 56 && next_ < end_) {
+        acc_ |= static_cast<uint64_t>(*next_++) << (56 - avail_);
+        avail_ += 8;
+    }
+}
+
+
+#endif
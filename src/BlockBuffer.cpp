@@ -0,0 +1,187 @@
+
+#include "BlockBuffer.h"
+
+#include <algorithm>
+
+/***** CONSTRUCTORS *****/
+
+// size is the number of bytes already in the file. Blocks are only loaded
+// and stored when they are used, so the owner must sync the buffer before
+// destroying it to store the last block.
+BlockBuffer::BlockBuffer(int64_t block_size, int64_t size, bool writable):
+    buffer_(static_cast<size_t>(block_size)),
+    block_size_(block_size),
+    size_(size),
+    block_(-1),
+    block_len_(0),
+    pos_(0),
+    dirty_(false),
+    writable_(writable) { }
+
+/***** GETTERS/ACCESSORS *****/
+
+int64_t BlockBuffer::getBlockSize() const { return block_size_; }
+
+// Returns the number of bytes in the stream, including writes that are
+// still buffered.
+int64_t BlockBuffer::getSize() const {
+    if (pbase() != nullptr)
+        return std::max(size_, block_ * block_size_ + (pptr() - pbase()));
+    return size_;
+}
+
+int64_t BlockBuffer::getBlockCount() const {
+    return (getSize() + block_size_ - 1) / block_size_;
+}
+
+bool BlockBuffer::isWritable() const { return writable_; }
+
+/***** BLOCK FUNCTIONS *****/
+
+// Returns the current stream position.
+int64_t BlockBuffer::position() const {
+    if (eback() != nullptr)
+        return block_ * block_size_ + (gptr() - eback());
+    if (pbase() != nullptr)
+        return block_ * block_size_ + (pptr() - pbase());
+    return pos_;
+}
+
+// Drops the get and put areas, keeping the block in the buffer, and records
+// the position and any bytes written past the end of the block.
+void BlockBuffer::detach() {
+    pos_ = position();
+
+    if (pbase() != nullptr) {
+        block_len_ = std::max<int64_t>(block_len_, pptr() - pbase());
+        size_ = std::max(size_, block_ * block_size_ + block_len_);
+    }
+
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+}
+
+// Makes block index the buffered block, storing the current one first if
+// it has been written to.
+bool BlockBuffer::selectBlock(int64_t index) {
+    if (index == block_)
+        return true;
+
+    if (!flushBlock())
+        return false;
+    block_ = -1;
+
+    // blocks at the end of the stream start out empty
+    int64_t len = std::clamp<int64_t>(size_ - index * block_size_, 0, block_size_);
+    if (len > 0 && !loadBlock(index, buffer_.data(), len))
+        return false;
+
+    block_ = index;
+    block_len_ = len;
+    dirty_ = false;
+    return true;
+}
+
+// Stores the buffered block if it has been written to.
+bool BlockBuffer::flushBlock() {
+    detach();
+
+    if (dirty_ && block_ >= 0) {
+        if (!storeBlock(block_, buffer_.data(), block_len_))
+            return false;
+        dirty_ = false;
+    }
+
+    return true;
+}
+
+// Drops the buffered block without storing it and starts over with a new
+// block size and stream size, for derived classes that only learn them
+// after construction.
+void BlockBuffer::reset(int64_t block_size, int64_t size) {
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+
+    buffer_.assign(static_cast<size_t>(block_size), 0);
+    block_size_ = block_size;
+    size_ = size;
+    block_ = -1;
+    block_len_ = 0;
+    pos_ = 0;
+    dirty_ = false;
+}
+
+/***** STREAMBUF OVERRIDES *****/
+
+// Makes the rest of the block at the current position readable.
+BlockBuffer::int_type BlockBuffer::underflow() {
+    if (gptr() != nullptr && gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    int64_t pos = position();
+    detach();
+    if (pos >= size_)
+        return traits_type::eof();
+
+    int64_t index = pos / block_size_;
+    if (!selectBlock(index))
+        return traits_type::eof();
+
+    char *data = buffer_.data();
+    int64_t offset = pos - index * block_size_;
+    setg(data, data + offset, data + block_len_);
+
+    return traits_type::to_int_type(*gptr());
+}
+
+// Makes the rest of the block at the current position writable and writes c.
+BlockBuffer::int_type BlockBuffer::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    if (!writable_)
+        return traits_type::eof();
+
+    int64_t pos = position();
+    detach();
+    if (pos > size_)
+        return traits_type::eof();
+
+    int64_t index = pos / block_size_;
+    if (!selectBlock(index))
+        return traits_type::eof();
+
+    char *data = buffer_.data();
+    setp(data, data + block_size_);
+    pbump(static_cast<int>(pos - index * block_size_));
+    dirty_ = true;
+
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+// Reading and writing share one position, so the open mode is ignored.
+BlockBuffer::pos_type BlockBuffer::seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode) {
+    detach();
+
+    int64_t base = 0;
+    if (dir == std::ios::cur)
+        base = pos_;
+    else if (dir == std::ios::end)
+        base = size_;
+
+    int64_t pos = base + static_cast<int64_t>(off);
+    if (pos < 0)
+        return pos_type(off_type(-1));
+
+    pos_ = pos;
+    return pos_type(pos);
+}
+
+BlockBuffer::pos_type BlockBuffer::seekpos(pos_type pos, std::ios::openmode which) {
+    return seekoff(off_type(pos), std::ios::beg, which);
+}
+
+int BlockBuffer::sync() {
+    return flushBlock() ? 0 : -1;
+}
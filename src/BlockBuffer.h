@@ -0,0 +1,91 @@
+/**
+ * @file BlockBuffer.h
+ * @author Danielle Fukunaga
+ * @brief A stream buffer that reads and writes a file in fixed-size blocks,
+ *        so each block can be checked or transformed as a whole.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef BLOCK_BUFFER_H
+#define BLOCK_BUFFER_H
+
+#include <cstdint>
+#include <ios>
+#include <streambuf>
+#include <vector>
+
+
+/**
+ * @brief Buffers one block of a file at a time for a std::fstream.
+ *
+ * The stream sees a plain byte stream with one shared read/write position,
+ * like std::filebuf. Underneath, the file is split into blocks of
+ * getBlockSize() bytes; only the last block may be shorter. A block is loaded
+ * whole the first time it is read or written, and stored whole when the
+ * position moves to another block or the buffer is synced. Seeking only
+ * records the new position, so tellg()/seekg() and DataFile::getFileSize()
+ * never load a block.
+ *
+ * Derived classes decide how a block is loaded and stored. Writing more than
+ * one byte past the end of the data is not supported.
+ *
+ */
+class BlockBuffer : public std::streambuf {
+public:
+    BlockBuffer(int64_t block_size, int64_t size, bool writable);
+    virtual ~BlockBuffer() = default;
+
+    BlockBuffer(const BlockBuffer &) = delete;
+    BlockBuffer                    &operator=(const BlockBuffer &) = delete;
+
+    // getters/accessors
+
+    int64_t                         getBlockSize() const;
+    int64_t                         getSize() const;
+    int64_t                         getBlockCount() const;
+    bool                            isWritable() const;
+
+protected:
+    // Loads len bytes of block index into data. len is block size bytes
+    // except for the last block. Returns false if the block cannot be loaded.
+    virtual bool                    loadBlock(int64_t index, char *data, int64_t len) = 0;
+    // Stores len bytes of block index from data. Returns false on an error.
+    virtual bool                    storeBlock(int64_t index, const char *data, int64_t len) = 0;
+
+    bool                            flushBlock();
+    void                            reset(int64_t block_size, int64_t size);
+
+    // streambuf overrides
+
+    int_type                        underflow() override;
+    int_type                        overflow(int_type c) override;
+    pos_type                        seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) override;
+    pos_type                        seekpos(pos_type pos, std::ios::openmode which) override;
+    int                             sync() override;
+
+private:
+    // helper functions
+
+    int64_t                         position() const;
+    void                            detach();
+    bool                            selectBlock(int64_t index);
+
+    // member variables
+
+    std::vector<char>               buffer_;
+    int64_t                         block_size_;
+    int64_t                         size_;          // bytes in the stream, including unstored writes
+    int64_t                         block_;         // index of the block in buffer_, or -1
+    int64_t                         block_len_;     // valid bytes in buffer_
+    int64_t                         pos_;           // stream position while no block area is set
+    bool                            dirty_;         // buffer_ has writes that are not stored yet
+    bool                            writable_;
+
+};
+
+
+#endif
@@ -0,0 +1,248 @@
+
+#include "BloomFilter.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(DATAFILE_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr uint32_t magic = 0x46424644;      // 'DFBF'
+    constexpr int64_t header_size = 32;
+
+    // odd multipliers that spread the low half of a hash over the 8 words
+    alignas(32) constexpr uint32_t salts[8] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+    };
+
+    void putLittle(unsigned char *out, uint64_t value, int size) {
+        for (int i = 0; i < size; ++i)
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    uint64_t getLittle(const unsigned char *in, int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        return value;
+    }
+
+    uint64_t bitMask(uint32_t low, int word) {
+        return 1ull << ((low * salts[word]) >> 26);
+    }
+
+#if defined(DATAFILE_X86)
+#if defined(__AVX2__)
+    constexpr bool has_avx2 = true;
+#else
+    const bool has_avx2 = CpuFeatures::hasAvx2();
+#endif
+
+    // the bit of each word as two vectors of 4 words
+    DATAFILE_TARGET("avx2")
+    inline void bitMasks(uint32_t low, __m256i &first, __m256i &second) {
+        __m256i positions = _mm256_srli_epi32(
+            _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(low)),
+                               _mm256_load_si256(reinterpret_cast<const __m256i*>(salts))), 26);
+        const __m256i one = _mm256_set1_epi64x(1);
+        first = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(positions)));
+        second = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(positions, 1)));
+    }
+
+    // Sets the bits of low in the 8 words of a block.
+    DATAFILE_TARGET("avx2")
+    void addAvx2(uint64_t *block, uint32_t low) {
+        __m256i first, second;
+        bitMasks(low, first, second);
+        __m256i *words = reinterpret_cast<__m256i*>(block);
+        _mm256_store_si256(words, _mm256_or_si256(_mm256_load_si256(words), first));
+        _mm256_store_si256(words + 1, _mm256_or_si256(_mm256_load_si256(words + 1), second));
+    }
+
+    // Returns true if all the bits of low are set in the 8 words of a block.
+    DATAFILE_TARGET("avx2")
+    bool containsAvx2(const uint64_t *block, uint32_t low) {
+        __m256i first, second;
+        bitMasks(low, first, second);
+        const __m256i *words = reinterpret_cast<const __m256i*>(block);
+        return _mm256_testc_si256(_mm256_load_si256(words), first) &&
+               _mm256_testc_si256(_mm256_load_si256(words + 1), second);
+    }
+#endif
+}
+
+BloomFilter::BloomFilter():
+    keys_(0) { }
+
+// Sizes the filter for expected_keys keys at bits_per_key bits each.
+BloomFilter::BloomFilter(int64_t expected_keys, int bits_per_key):
+    keys_(0) {
+    if (expected_keys < 0 || bits_per_key <= 0)
+        throw std::invalid_argument("Bloom filter size is out of range.");
+
+    int64_t bits = expected_keys * bits_per_key;
+    blocks_.resize(static_cast<size_t>(std::max<int64_t>(1, (bits + 8 * block_size - 1) / (8 * block_size))));
+    clear();
+}
+
+void BloomFilter::add(std::string_view key) { add(hash(key)); }
+
+void BloomFilter::add(uint64_t hash) {
+    if (blocks_.empty())
+        return;
+
+    Block &block = blocks_[blockIndex(hash)];
+    uint32_t low = static_cast<uint32_t>(hash);
+    ++keys_;
+#if defined(DATAFILE_X86)
+    if (has_avx2) {
+        addAvx2(block.words, low);
+        return;
+    }
+#endif
+    for (int i = 0; i < 8; ++i)
+        block.words[i] |= bitMask(low, i);
+}
+
+// Returns false if key was never added. An empty filter may contain anything.
+bool BloomFilter::mayContain(std::string_view key) const { return mayContain(hash(key)); }
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    if (blocks_.empty())
+        return true;
+
+    const Block &block = blocks_[blockIndex(hash)];
+    uint32_t low = static_cast<uint32_t>(hash);
+#if defined(DATAFILE_X86)
+    if (has_avx2)
+        return containsAvx2(block.words, low);
+#endif
+    for (int i = 0; i < 8; ++i) {
+        uint64_t mask = bitMask(low, i);
+        if ((block.words[i] & mask) != mask)
+            return false;
+    }
+    return true;
+}
+
+// Removes every key, keeping the size.
+void BloomFilter::clear() {
+    std::memset(static_cast<void*>(blocks_.data()), 0, blocks_.size() * sizeof(Block));
+    keys_ = 0;
+}
+
+/***** SIDECAR FUNCTIONS *****/
+
+// Writes the filter to path for a data file of data_size bytes.
+//
+// Throws std::ios_base::failure if the sidecar cannot be written.
+void BloomFilter::save(const std::string &path, int64_t data_size) const {
+    int64_t count = getBlockCount();
+    std::vector<unsigned char> bytes(static_cast<size_t>(header_size + count * block_size));
+    putLittle(bytes.data(), magic, 4);
+    putLittle(bytes.data() + 4, static_cast<uint64_t>(block_size), 4);
+    putLittle(bytes.data() + 8, static_cast<uint64_t>(count), 8);
+    putLittle(bytes.data() + 16, static_cast<uint64_t>(data_size), 8);
+    putLittle(bytes.data() + 24, static_cast<uint64_t>(keys_), 8);
+
+    unsigned char *out = bytes.data() + header_size;
+    for (const Block &block : blocks_) {
+        for (uint64_t word : block.words) {
+            putLittle(out, word, 8);
+            out += 8;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (file.fail())
+        throw std::ios_base::failure("Failed to write the Bloom filter file.");
+}
+
+// Reads the filter saved at path for a data file of data_size bytes. Returns
+// false, leaving the filter as it was, if there is no sidecar or it does not
+// belong to a file of that size.
+bool BloomFilter::load(const std::string &path, int64_t data_size) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // the block count must match the sidecar's size before it is allocated
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(path, error);
+    if (error || file_size < static_cast<uintmax_t>(header_size))
+        return false;
+
+    unsigned char header[header_size];
+    file.read(reinterpret_cast<char*>(header), header_size);
+    uint64_t count = getLittle(header + 8, 8);
+    if (file.gcount() != header_size ||
+        getLittle(header, 4) != magic ||
+        static_cast<int64_t>(getLittle(header + 4, 4)) != block_size ||
+        static_cast<int64_t>(getLittle(header + 16, 8)) != data_size ||
+        count < 1 || count != (file_size - header_size) / block_size ||
+        (file_size - header_size) % block_size != 0)
+        return false;
+
+    // one read for all the blocks
+    std::vector<unsigned char> bytes(static_cast<size_t>(count * block_size));
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (file.gcount() != static_cast<std::streamsize>(bytes.size()))
+        return false;
+
+    blocks_.resize(static_cast<size_t>(count));
+    const unsigned char *in = bytes.data();
+    for (Block &block : blocks_) {
+        for (uint64_t &word : block.words) {
+            word = getLittle(in, 8);
+            in += 8;
+        }
+    }
+    keys_ = static_cast<int64_t>(getLittle(header + 24, 8));
+    return true;
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+int64_t BloomFilter::getBlockCount() const { return static_cast<int64_t>(blocks_.size()); }
+
+int64_t BloomFilter::getKeyCount() const { return keys_; }
+
+// MurmurHash64A of key, read little-endian so every host gets the same hash.
+uint64_t BloomFilter::hash(std::string_view key) {
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(key.data());
+    size_t len = key.size();
+
+    uint64_t h = 0x8445d61a4e774912ull ^ (len * m);
+    for (; len >= 8; len -= 8, data += 8) {
+        uint64_t k = getLittle(data, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (len > 0) {
+        h ^= getLittle(data, static_cast<int>(len));
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+// The high half of the hash picks the block, without a division.
+size_t BloomFilter::blockIndex(uint64_t hash) const {
+    return static_cast<size_t>(((hash >> 32) * static_cast<uint64_t>(blocks_.size())) >> 32);
+}
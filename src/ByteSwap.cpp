@@ -0,0 +1,104 @@
+
+#include "ByteSwap.h"
+#include "CpuFeatures.h"
+
+#if defined(DATAFILE_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // pshufb masks that reverse each 2, 4 or 8 byte group of a 16 byte lane
+    alignas(16) const uint8_t reverse_16[16] = {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+    alignas(16) const uint8_t reverse_32[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+    alignas(16) const uint8_t reverse_64[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+#if defined(DATAFILE_X86)
+#if defined(__AVX2__)
+    constexpr bool has_avx2 = true;
+#else
+    const bool has_avx2 = CpuFeatures::hasAvx2();
+#endif
+#if defined(__SSSE3__)
+    constexpr bool has_ssse3 = true;
+#else
+    const bool has_ssse3 = CpuFeatures::hasSsse3();
+#endif
+
+    // Shuffles as many whole 16 byte vectors as fit in size bytes, starting
+    // at done, and returns the number of bytes done.
+    DATAFILE_TARGET("ssse3")
+    size_t shuffleSsse3(unsigned char *data, size_t size, const uint8_t *mask, size_t done) {
+        __m128i lane_mask = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+        for (; done + 16 <= size; done += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + done));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + done), _mm_shuffle_epi8(block, lane_mask));
+        }
+        return done;
+    }
+
+    // Same with 32 byte vectors, leaving the last 16 bytes to shuffleSsse3().
+    DATAFILE_TARGET("avx2")
+    size_t shuffleAvx2(unsigned char *data, size_t size, const uint8_t *mask) {
+        // vpshufb shuffles within each 16 byte lane, so the same mask is used twice
+        __m256i wide_mask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask)));
+        size_t done = 0;
+        for (; done + 32 <= size; done += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + done));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + done), _mm256_shuffle_epi8(block, wide_mask));
+        }
+        return done;
+    }
+#endif
+
+    // Shuffles as many whole vectors as fit in size bytes and returns the number
+    // of bytes done. The scalar loops in the callers finish the rest.
+    size_t shuffleBytes([[maybe_unused]] unsigned char *data, [[maybe_unused]] size_t size,
+                        [[maybe_unused]] const uint8_t *mask) {
+        size_t done = 0;
+#if defined(DATAFILE_X86)
+        if (has_avx2)
+            done = shuffleAvx2(data, size, mask);
+        if (has_ssse3)
+            done = shuffleSsse3(data, size, mask, done);
+#endif
+        return done;
+    }
+}
+
+/***** ARRAY SWAPS *****/
+
+void ByteSwap::swapArray16(void *data, size_t count) {
+    unsigned char *bytes = static_cast<unsigned char*>(data);
+    size_t done = shuffleBytes(bytes, count * 2, reverse_16);
+
+    for (size_t i = done; i < count * 2; i += 2) {
+        uint16_t value;
+        std::memcpy(&value, bytes + i, sizeof(value));
+        value = swap16(value);
+        std::memcpy(bytes + i, &value, sizeof(value));
+    }
+}
+
+void ByteSwap::swapArray32(void *data, size_t count) {
+    unsigned char *bytes = static_cast<unsigned char*>(data);
+    size_t done = shuffleBytes(bytes, count * 4, reverse_32);
+
+    for (size_t i = done; i < count * 4; i += 4) {
+        uint32_t value;
+        std::memcpy(&value, bytes + i, sizeof(value));
+        value = swap32(value);
+        std::memcpy(bytes + i, &value, sizeof(value));
+    }
+}
+
+void ByteSwap::swapArray64(void *data, size_t count) {
+    unsigned char *bytes = static_cast<unsigned char*>(data);
+    size_t done = shuffleBytes(bytes, count * 8, reverse_64);
+
+    for (size_t i = done; i < count * 8; i += 8) {
+        uint64_t value;
+        std::memcpy(&value, bytes + i, sizeof(value));
+        value = swap64(value);
+        std::memcpy(bytes + i, &value, sizeof(value));
+    }
+}
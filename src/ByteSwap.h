@@ -0,0 +1,126 @@
+/**
+ * @file ByteSwap.h
+ * @author Danielle Fukunaga
+ * @brief Byte order helpers for reading and writing files in a fixed
+ *        endianness.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef BYTE_SWAP_H
+#define BYTE_SWAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+
+namespace ByteSwap {
+    inline uint16_t swap16(uint16_t value) {
+#if defined(_MSC_VER)
+        return _byteswap_ushort(value);
+#else
+        return __builtin_bswap16(value);
+#endif
+    }
+
+    inline uint32_t swap32(uint32_t value) {
+#if defined(_MSC_VER)
+        return _byteswap_ulong(value);
+#else
+        return __builtin_bswap32(value);
+#endif
+    }
+
+    inline uint64_t swap64(uint64_t value) {
+#if defined(_MSC_VER)
+        return _byteswap_uint64(value);
+#else
+        return __builtin_bswap64(value);
+#endif
+    }
+
+    // Reverse the bytes of every element of an array of 2, 4 or 8 byte values.
+    // Uses pshufb on x86 CPUs with SSSE3 or AVX2, checked at run time.
+    void swapArray16(void *data, size_t count);
+    void swapArray32(void *data, size_t count);
+    void swapArray64(void *data, size_t count);
+
+    // true for types whose byte order depends on the host: integers, floating
+    // point numbers and enums of 2, 4 or 8 bytes
+    template<typename T>
+    constexpr bool is_swappable = (std::is_arithmetic_v<T> || std::is_enum_v<T>) &&
+                                  (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+    // Returns value with its bytes reversed.
+    template<typename T>
+    T swap(T value) {
+        static_assert(is_swappable<T>, "swap() needs a 2, 4 or 8 byte arithmetic or enum type.");
+
+        if constexpr (sizeof(T) == 2) {
+            uint16_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = swap16(bits);
+            std::memcpy(&value, &bits, sizeof(bits));
+        } else if constexpr (sizeof(T) == 4) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = swap32(bits);
+            std::memcpy(&value, &bits, sizeof(bits));
+        } else {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = swap64(bits);
+            std::memcpy(&value, &bits, sizeof(bits));
+        }
+
+        return value;
+    }
+
+    // Reverses the bytes of len values in place. Does nothing for types that
+    // are not swappable, such as single bytes and structs.
+    template<typename T>
+    void swapArray(T *data, int64_t len) {
+        if constexpr (is_swappable<T>) {
+            if constexpr (sizeof(T) == 2)
+                swapArray16(data, static_cast<size_t>(len));
+            else if constexpr (sizeof(T) == 4)
+                swapArray32(data, static_cast<size_t>(len));
+            else
+                swapArray64(data, static_cast<size_t>(len));
+        }
+    }
+
+    // Reverses the bytes of a field in place: a swappable value, or every
+    // element of a C array or std::array of them. Other types are left as is.
+    template<typename T, size_t N>
+    void swapValue(std::array<T, N> &value);
+
+    template<typename T>
+    void swapValue(T &value) {
+        if constexpr (is_swappable<T>) {
+            value = swap(value);
+        } else if constexpr (std::is_array_v<T>) {
+            for (auto &element : value)
+                swapValue(element);
+        }
+    }
+
+    template<typename T, size_t N>
+    void swapValue(std::array<T, N> &value) {
+        for (T &element : value)
+            swapValue(element);
+    }
+}
+
+
+#endif
@@ -0,0 +1,266 @@
+
+#include "ChecksumBuffer.h"
+#include "Crc32c.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace {
+    // little-endian helpers for the sidecar layout
+    void putLittle(unsigned char *out, uint64_t value, int size) {
+        for (int i = 0; i < size; ++i)
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    uint64_t getLittle(const unsigned char *in, int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        return value;
+    }
+}
+
+/***** CHECKSUM ERROR *****/
+
+ChecksumError::ChecksumError(int64_t block):
+    std::runtime_error("Checksum mismatch in block " + std::to_string(block) + "."),
+    block_(block) { }
+
+// Returns the index of the block that failed its check.
+int64_t ChecksumError::getBlock() const { return block_; }
+
+/***** CONSTRUCTORS *****/
+
+// file is the buffer that reaches the disk, normally the fstream's own
+// filebuf, and must be open for reading.
+ChecksumBuffer::ChecksumBuffer(std::streambuf *file, std::string checksum_path, int64_t block_size, bool writable):
+    BlockBuffer(block_size, fileSize(file), writable),
+    file_(file),
+    checksum_path_(checksum_path),
+    bad_block_(-1),
+    failed_(false) { }
+
+// Returns the size of file and moves its position back to the start.
+int64_t ChecksumBuffer::fileSize(std::streambuf *file) {
+    std::streamoff size = file->pubseekoff(0, std::ios::end, std::ios::in);
+    file->pubseekpos(0, std::ios::in);
+    return size < 0 ? 0 : static_cast<int64_t>(size);
+}
+
+/***** SIDECAR FUNCTIONS *****/
+
+// Reads the checksums of an existing file.
+//
+// An empty file, or a file without a sidecar, starts without checksums.
+// Throws std::runtime_error if the sidecar belongs to a different block size
+// or file size, since the file was then changed without its checksums.
+void ChecksumBuffer::load() {
+    if (getSize() == 0)
+        return;
+
+    std::ifstream in(checksum_path_, std::ios::binary);
+    if (!in.is_open())
+        return;
+
+    unsigned char header[header_size];
+    in.read(reinterpret_cast<char*>(header), header_size);
+    if (in.gcount() != header_size ||
+        getLittle(header, 4) != magic ||
+        static_cast<int64_t>(getLittle(header + 4, 4)) != getBlockSize() ||
+        static_cast<int64_t>(getLittle(header + 8, 8)) != getSize())
+        throw std::runtime_error("Checksum file does not match the data file.");
+
+    // one read for all the checksums
+    int64_t count = getBlockCount();
+    std::vector<unsigned char> bytes(static_cast<size_t>(count) * 4);
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (in.gcount() != static_cast<std::streamsize>(bytes.size()))
+        throw std::runtime_error("Checksum file is truncated.");
+
+    checksums_.resize(static_cast<size_t>(count));
+    known_.assign(static_cast<size_t>(count), true);
+    std::vector<uint64_t> leaves(static_cast<size_t>(count));
+    for (int64_t i = 0; i < count; ++i) {
+        checksums_[i] = static_cast<uint32_t>(getLittle(bytes.data() + 4 * i, 4));
+        leaves[i] = MerkleTree::leafHash(checksums_[i], std::min(getBlockSize(), getSize() - i * getBlockSize()));
+    }
+
+    // the root catches damage to the sidecar itself
+    tree_.assign(leaves);
+    if (tree_.getRoot() != getLittle(header + 16, 8))
+        throw std::runtime_error("Checksum file is corrupt.");
+}
+
+// Stores the buffered block and writes the sidecar. Blocks that have never
+// been read or written are checksummed first. Does nothing for read-only files.
+//
+// Throws std::ios_base::failure if a block or the sidecar cannot be written.
+void ChecksumBuffer::save() {
+    if (!isWritable())
+        return;
+
+    complete();
+
+    int64_t count = getBlockCount();
+    std::vector<unsigned char> bytes(static_cast<size_t>(header_size + count * 4));
+    putLittle(bytes.data(), magic, 4);
+    putLittle(bytes.data() + 4, static_cast<uint64_t>(getBlockSize()), 4);
+    putLittle(bytes.data() + 8, static_cast<uint64_t>(getSize()), 8);
+    putLittle(bytes.data() + 16, tree_.getRoot(), 8);
+    for (int64_t i = 0; i < count; ++i)
+        putLittle(bytes.data() + header_size + 4 * i, checksums_[i], 4);
+
+    std::ofstream out(checksum_path_, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (out.fail())
+        throw std::ios_base::failure("Failed to write the checksum file.");
+}
+
+// Stores the buffered block and checksums every block that does not have
+// a checksum yet, so the checksums and the tree cover the whole file.
+void ChecksumBuffer::complete() {
+    if (pubsync() != 0)
+        throw std::ios_base::failure("Failed to write a block.");
+
+    int64_t count = getBlockCount();
+    std::vector<char> data(static_cast<size_t>(getBlockSize()));
+    for (int64_t i = 0; i < count; ++i) {
+        if (i < static_cast<int64_t>(known_.size()) && known_[i])
+            continue;
+        int64_t len = std::min(getBlockSize(), getSize() - i * getBlockSize());
+        if (!loadBlock(i, data.data(), len))
+            throw std::ios_base::failure("Failed to read a block.");
+    }
+}
+
+/***** VERIFY *****/
+
+// Re-reads every block with a checksum from file_path and returns the
+// indexes of the blocks that do not match, in order.
+//
+// The blocks are split between a pool of threads, each with its own file
+// handle, so checksumming overlaps with I/O. If threads is 0, one thread per
+// hardware core is used.
+std::vector<int64_t> ChecksumBuffer::verify(const std::string &file_path, unsigned int threads) {
+    // make sure the disk has every write
+    if (pubsync() != 0)
+        throw std::ios_base::failure("Failed to write a block.");
+
+    int64_t count = std::min<int64_t>(getBlockCount(), static_cast<int64_t>(known_.size()));
+    int64_t block_size = getBlockSize();
+    int64_t size = getSize();
+
+    // workers take batches of neighbouring blocks to keep reads sequential
+    const int64_t batch = 16;
+    std::atomic<int64_t> next(0);
+    std::vector<std::vector<int64_t>> bad(std::max(1u, threads == 0 ? std::thread::hardware_concurrency() : threads));
+
+    auto worker = [&](std::vector<int64_t> &found) {
+        std::ifstream in(file_path, std::ios::binary);
+        std::vector<char> data(static_cast<size_t>(block_size));
+        for (int64_t first = next.fetch_add(batch); first < count; first = next.fetch_add(batch)) {
+            int64_t last = std::min(first + batch, count);
+            in.clear();
+            in.seekg(first * block_size);
+            for (int64_t i = first; i < last; ++i) {
+                int64_t len = std::min(block_size, size - i * block_size);
+                in.read(data.data(), static_cast<std::streamsize>(len));
+                if (!known_[i])
+                    continue;
+                if (in.gcount() != len || Crc32c::compute(data.data(), static_cast<size_t>(len)) != checksums_[i])
+                    found.push_back(i);
+            }
+        }
+    };
+
+    size_t pool_size = std::min<size_t>(bad.size(), static_cast<size_t>((count + batch - 1) / batch));
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < pool_size; ++i)
+        pool.emplace_back(worker, std::ref(bad[i]));
+    worker(bad[0]);
+    for (auto &thread : pool)
+        thread.join();
+
+    // gather results in block order
+    std::vector<int64_t> result;
+    for (const auto &found : bad)
+        result.insert(result.end(), found.begin(), found.end());
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+// Returns the hash tree over every block of the file, storing the buffered
+// block first.
+const MerkleTree &ChecksumBuffer::getTree() {
+    complete();
+    return tree_;
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+std::string ChecksumBuffer::getChecksumPath() const { return checksum_path_; }
+
+// Returns the last block that failed its check, or -1.
+int64_t ChecksumBuffer::getBadBlock() const { return bad_block_; }
+
+// Returns true if a block has failed its check since the last call.
+bool ChecksumBuffer::takeFailure() {
+    bool failed = failed_;
+    failed_ = false;
+    return failed;
+}
+
+/***** BLOCK FUNCTIONS *****/
+
+// Keeps the checksum of a block and updates its path in the tree.
+void ChecksumBuffer::record(int64_t index, uint32_t checksum, int64_t len) {
+    if (index >= static_cast<int64_t>(checksums_.size())) {
+        checksums_.resize(static_cast<size_t>(index) + 1);
+        known_.resize(static_cast<size_t>(index) + 1, false);
+    }
+    checksums_[index] = checksum;
+    known_[index] = true;
+    tree_.setLeaf(index, MerkleTree::leafHash(checksum, len));
+}
+
+// Reads a block and checks it against its checksum, or records its checksum
+// if it does not have one yet.
+bool ChecksumBuffer::loadBlock(int64_t index, char *data, int64_t len) {
+    file_->pubseekpos(index * getBlockSize(), std::ios::in);
+    if (file_->sgetn(data, len) != len)
+        return false;
+
+    uint32_t checksum = Crc32c::compute(data, static_cast<size_t>(len));
+    if (index < static_cast<int64_t>(known_.size()) && known_[index]) {
+        if (checksum != checksums_[index]) {
+            bad_block_ = index;
+            failed_ = true;
+            return false;
+        }
+    } else {
+        record(index, checksum, len);
+    }
+
+    return true;
+}
+
+// Writes a block and records its new checksum.
+bool ChecksumBuffer::storeBlock(int64_t index, const char *data, int64_t len) {
+    file_->pubseekpos(index * getBlockSize(), std::ios::out);
+    if (file_->sputn(data, len) != len)
+        return false;
+
+    record(index, Crc32c::compute(data, static_cast<size_t>(len)), len);
+    return true;
+}
+
+// Stores the buffered block and flushes the file.
+int ChecksumBuffer::sync() {
+    if (BlockBuffer::sync() != 0)
+        return -1;
+    return file_->pubsync();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file ChecksumBuffer.h
+ * @author Danielle Fukunaga
+ * @brief A block stream buffer that keeps a CRC-32C for every block of a
+ *        file and checks it when the block is read.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef CHECKSUM_BUFFER_H
+#define CHECKSUM_BUFFER_H
+
+#include "BlockBuffer.h"
+#include "MerkleTree.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Thrown when a block does not match its checksum.
+ *
+ */
+class ChecksumError : public std::runtime_error {
+public:
+    explicit ChecksumError(int64_t block);
+
+    int64_t                         getBlock() const;
+
+private:
+    int64_t                         block_;
+
+};
+
+/**
+ * @brief Checksums a file block by block on its way to and from disk.
+ *
+ * The checksum of a block is computed when the block is stored and checked
+ * when it is loaded, so corruption is found at block granularity without a
+ * separate pass over the file. Checksums are kept in a sidecar file,
+ * <file>.crc, which is written by save() and read by load():
+ *
+ * - 0  uint32_t magic           'CRCC'
+ *
+ * - 4  uint32_t block size
+ *
+ * - 8  uint64_t data size       size of the file the checksums belong to
+ *
+ * - 16 uint64_t root hash       MerkleTree root over the checksums
+ *
+ * - 24 uint32_t checksums[]     one per block
+ *
+ * all little-endian. Blocks of a file that had no sidecar are not checked
+ * until they have been read or written once.
+ *
+ * A MerkleTree over the checksums is rebuilt from the sidecar at load and
+ * updated as blocks are stored, so getTree() gives the root hash of the whole
+ * file, or the blocks that differ from a replica, without reading the file.
+ *
+ * A block that fails its check is not returned; reads stop at it as if at
+ * the end of the file, takeFailure() reports that it happened and
+ * getBadBlock() reports its index.
+ *
+ */
+class ChecksumBuffer : public BlockBuffer {
+public:
+    ChecksumBuffer(std::streambuf *file, std::string checksum_path, int64_t block_size, bool writable);
+
+    void                            load();
+    void                            save();
+    std::vector<int64_t>            verify(const std::string &file_path, unsigned int threads);
+    const MerkleTree               &getTree();
+
+    // getters/accessors
+
+    std::string                     getChecksumPath() const;
+    int64_t                         getBadBlock() const;
+    bool                            takeFailure();
+
+    // static constants
+
+    static constexpr uint32_t       magic = 0x43435243;
+    static constexpr int64_t        header_size = 24;
+
+protected:
+    // BlockBuffer overrides
+
+    bool                            loadBlock(int64_t index, char *data, int64_t len) override;
+    bool                            storeBlock(int64_t index, const char *data, int64_t len) override;
+    int                             sync() override;
+
+private:
+    // helper functions
+
+    static int64_t                  fileSize(std::streambuf *file);
+    void                            record(int64_t index, uint32_t checksum, int64_t len);
+    void                            complete();
+
+    // member variables
+
+    std::streambuf                 *file_;          // the fstream's own filebuf
+    std::string                     checksum_path_;
+    std::vector<uint32_t>           checksums_;
+    std::vector<char>               known_;         // true where checksums_ holds a checksum
+    MerkleTree                      tree_;          // over the known checksums
+    int64_t                         bad_block_;     // last block that failed its check, or -1
+    bool                            failed_;        // a block failed since the last takeFailure()
+
+};
+
+
+#endif
@@ -0,0 +1,948 @@
+/**
+ * @file ColumnFile.h
+ * @author Danielle Fukunaga
+ * @brief Column-wise storage for arrays of records, so that a query reads
+ *        only the fields it needs.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include "DataFile.h"
+#include "Record.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+/**
+ * @brief How the values of a column chunk are stored.
+ *
+ * - plain              = fixed-size values back to back as writeArray writes
+ *                        them, other values one after another as DataFile
+ *                        writes them
+ *
+ * - delta              = integers packed with writePackedArray and
+ *                        IntEncoding::delta
+ *
+ * - frame_of_reference = integers packed with writePackedArray and
+ *                        IntEncoding::frame_of_reference
+ *
+ * - dictionary         = strings stored once per chunk, in order of first
+ *                        use, then one packed uint32_t code per row
+ *
+ */
+enum class ColumnEncoding : uint32_t {
+    plain = 0,
+    delta = 1,
+    frame_of_reference = 2,
+    dictionary = 3
+};
+
+/**
+ * @brief The zone map entry of one column chunk: the range of its values.
+ *
+ * Kept for integer and floating-point fields. NaN values are counted as
+ * nulls and left out of min and max; a chunk of only nulls has min and max
+ * of zero.
+ *
+ */
+template<typename T>
+struct ColumnStats {
+    T                               min;
+    T                               max;
+    int64_t                         null_count;
+    int64_t                         rows;
+};
+
+/***** COLUMN HELPERS *****/
+
+namespace ColumnDetail {
+    // fixed-size fields are stored as their elements, so arrays are flattened
+    template<typename T> using Element = std::remove_all_extents_t<T>;
+    template<typename T> constexpr int64_t extent = sizeof(T) / sizeof(Element<T>);
+
+    // the values of one column in memory: elements for fixed-size fields,
+    // whole values for the rest
+    template<typename T> using Buffer =
+        std::conditional_t<RecordDetail::is_fixed<T>, std::vector<Element<T>>, std::vector<T>>;
+    template<typename T> using Value = typename Buffer<T>::value_type;
+
+    // fields that can be delta or frame-of-reference encoded
+    template<typename T> constexpr bool is_packable = RecordDetail::is_fixed<T> && BitPackDetail::is_packable<Element<T>>;
+    // fields that can be dictionary encoded
+    template<typename T> constexpr bool is_string = std::is_same_v<T, std::string>;
+
+    // fields with a zone map entry per chunk
+    template<typename T> constexpr bool has_stats = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+    template<typename T> using Stats = std::conditional_t<has_stats<T>, ColumnStats<T>, std::monostate>;
+    // bytes of the zone map entry of a T field: min, max and int64_t null count
+    template<typename T> constexpr int64_t stats_entry_size = has_stats<T> ? 2 * static_cast<int64_t>(sizeof(T)) + 8 : 0;
+
+    // Returns true if fields of type T can be stored with encoding.
+    template<typename T>
+    constexpr bool supports(ColumnEncoding encoding) {
+        switch (encoding) {
+            case ColumnEncoding::plain:
+                return true;
+            case ColumnEncoding::delta:
+            case ColumnEncoding::frame_of_reference:
+                return is_packable<T>;
+            case ColumnEncoding::dictionary:
+                return is_string<T>;
+        }
+        return false;
+    }
+
+    template<typename Fields, typename I> struct Columns;
+    template<typename Fields, size_t... I> struct Columns<Fields, std::index_sequence<I...>> {
+        using Type = std::tuple<Buffer<typename Fields::template FieldType<I>>...>;
+    };
+    // one buffer per field of Fields
+    template<typename Fields> using ColumnsOf =
+        typename Columns<Fields, std::make_index_sequence<Fields::field_count>>::Type;
+
+    template<typename Fields, typename I> struct ZoneMaps;
+    template<typename Fields, size_t... I> struct ZoneMaps<Fields, std::index_sequence<I...>> {
+        using Type = std::tuple<std::vector<Stats<typename Fields::template FieldType<I>>>...>;
+        static constexpr int64_t group_size = (stats_entry_size<typename Fields::template FieldType<I>> + ... + 0);
+    };
+    // one entry per row group for each field of Fields
+    template<typename Fields> using ZoneMapsOf =
+        typename ZoneMaps<Fields, std::make_index_sequence<Fields::field_count>>::Type;
+    // bytes of the zone map of one row group
+    template<typename Fields> constexpr int64_t zone_map_group_size =
+        ZoneMaps<Fields, std::make_index_sequence<Fields::field_count>>::group_size;
+
+    // Returns the range of values, leaving NaN out.
+    template<typename T>
+    ColumnStats<T> computeStats(const std::vector<T> &values) {
+        ColumnStats<T> stats = {T(), T(), 0, static_cast<int64_t>(values.size())};
+        bool any = false;
+        for (T value : values) {
+            if constexpr (std::is_floating_point_v<T>) {
+                if (std::isnan(value)) {
+                    ++stats.null_count;
+                    continue;
+                }
+            }
+            stats.min = any ? std::min(stats.min, value) : value;
+            stats.max = any ? std::max(stats.max, value) : value;
+            any = true;
+        }
+        return stats;
+    }
+
+    struct Chunk {
+        int64_t                     offset;         // file position of the first value
+        int64_t                     size;           // bytes
+        ColumnEncoding              encoding;
+    };
+
+    // Returns the most rows a chunk can hold. Plain values take at least a
+    // byte each; packed ones take the packed size, the encoding byte and at
+    // least a byte per block.
+    inline int64_t maxRows(const Chunk &chunk) {
+        if (chunk.encoding == ColumnEncoding::plain)
+            return chunk.size;
+        return chunk.size < 9 ? 0 : (chunk.size - 9) * BitPack::block_size;
+    }
+
+    struct RowGroup {
+        int64_t                     rows;
+        std::vector<Chunk>          chunks;         // one per field
+    };
+
+    // the strings of one chunk as views into an arena
+    struct StringChunk {
+        StringArena                 arena;
+        std::vector<std::string_view> dictionary;
+        std::vector<uint32_t>       codes;
+        std::vector<std::string_view> views;        // one per row
+        int64_t                     group = -1;     // row group in views, or -1
+    };
+
+    constexpr uint32_t              magic = 0x4C434644;     // 'DFCL'
+    constexpr uint32_t              zone_map_magic = 0x4D5A4644;    // 'DFZM'
+    constexpr int64_t               trailer_size = 12;
+    constexpr int64_t               chunk_entry_size = 20;
+}
+
+/**
+ * @brief Writes records field by field instead of row by row.
+ *
+ * Rows are buffered in memory until row_group_size of them are written, then
+ * stored as a row group: one contiguous column chunk per field, in field
+ * order. finish() appends a footer that lists every chunk, so the file reads:
+ *
+ *     [group 0: column 0][column 1]...[group 1: column 0]...[footer][trailer]
+ *
+ * The footer holds uint64_t Fields::schema_hash, uint32_t column count,
+ * int64_t row group count, then for each row group its int64_t row count and,
+ * for each column, int64_t offset, int64_t size and uint32_t ColumnEncoding.
+ * With enableZoneMaps(), the footer goes on with uint32_t magic 'DFZM' and,
+ * for each row group, the min, max and int64_t null count of every integer
+ * and floating-point field, in field order, so a reader can skip row groups
+ * that cannot match a range. The 12 byte trailer is the int64_t footer
+ * offset followed by uint32_t magic 'DFCL'. Everything is written through
+ * the DataFile, in its byte order.
+ *
+ * Writing starts at the end of the file. Fixed-size fields are written with
+ * one writeArray call per chunk; strings and containers use the matching
+ * DataFile overloads. Integer fields can be bit-packed instead, and string
+ * fields dictionary encoded, with setEncoding().
+ *
+ */
+template<typename Fields>
+class ColumnWriter {
+public:
+    using Type = typename Fields::Type;
+
+    explicit ColumnWriter(DataFile &file, int64_t row_group_size = default_row_group_size);
+    ~ColumnWriter();
+
+    ColumnWriter(const ColumnWriter &) = delete;
+    ColumnWriter                   &operator=(const ColumnWriter &) = delete;
+
+    template<auto Member> void      setEncoding(ColumnEncoding encoding);
+    void                            enableZoneMaps();
+    void                            write(const Type &row);
+    void                            write(const Type *rows, int64_t count);
+    void                            flush();
+    void                            finish();
+
+    // getters/accessors
+
+    int64_t                         getRowCount() const;
+    int64_t                         getRowGroupCount() const;
+
+    // static constants
+
+    static constexpr int64_t        default_row_group_size = 64 * 1024;
+
+private:
+    // helper functions
+
+    template<size_t... I>
+    void                            appendRow(const Type &row, std::index_sequence<I...>);
+    template<size_t... I>
+    void                            writeChunks(ColumnDetail::RowGroup &group, std::index_sequence<I...>);
+    template<size_t I>
+    void                            writeChunk(ColumnDetail::RowGroup &group);
+    void                            writeDictionary(const std::vector<std::string> &column);
+    void                            writeFooter();
+    template<size_t... I>
+    void                            writeZoneMaps(std::index_sequence<I...>);
+
+    // member variables
+
+    DataFile                       *file_;
+    int64_t                         row_group_size_;
+    int64_t                         pos_;           // where the next chunk is written
+    int64_t                         buffered_;      // rows in columns_
+    int64_t                         rows_;          // rows written, including buffered ones
+    bool                            finished_;
+    bool                            zone_maps_;
+    ColumnDetail::ColumnsOf<Fields> columns_;
+    std::array<ColumnEncoding, Fields::field_count> encodings_;
+    std::vector<ColumnDetail::RowGroup> groups_;
+    ColumnDetail::ZoneMapsOf<Fields> stats_;
+
+};
+
+/**
+ * @brief Reads a file written by ColumnWriter, one column chunk at a time.
+ *
+ * The footer is read when the reader is made. readColumn() then reads a
+ * single chunk and returns its values as a span, so a projection over a few
+ * fields never touches the bytes of the others:
+ *
+ *     ColumnReader<TestItemFields> reader(file);
+ *     for (int64_t g = 0; g < reader.getRowGroupCount(); ++g)
+ *         for (long long value : reader.readColumn<&TestItem::test_long>(g))
+ *             total += value;
+ *
+ * Fixed-size array fields come back flattened, extent values per row. The
+ * span stays valid until another row group of the same field is read; reading
+ * the same chunk again does not touch the file.
+ *
+ * readStrings() returns a string field as views instead. The strings are read
+ * into an arena that is reused from chunk to chunk, and a dictionary encoded
+ * chunk reads each distinct string once, so a scan does not allocate per row.
+ *
+ * When the file has zone maps, scan() reads only the row groups whose range
+ * of the field overlaps the query, and only reads their other fields when the
+ * field itself has a match:
+ *
+ *     reader.scan<&TestItem::test_long>(low, high, [&](const TestItem &item) { ... });
+ *
+ */
+template<typename Fields>
+class ColumnReader {
+public:
+    using Type = typename Fields::Type;
+
+    explicit ColumnReader(DataFile &file);
+
+    // getters/accessors
+
+    int64_t                         getRowCount() const;
+    int64_t                         getRowGroupCount() const;
+    int64_t                         getRowGroupRows(int64_t group) const;
+    bool                            hasZoneMaps() const;
+    template<auto Member> ColumnStats<RecordDetail::TypeOf<Member>> getStats(int64_t group) const;
+
+    // read functions
+
+    template<auto Member> auto      readColumn(int64_t group);
+    template<auto Member> std::span<const std::string_view> readStrings(int64_t group);
+    template<auto... Members> void  readRows(int64_t group, std::vector<Type> &rows);
+
+    // query functions
+
+    template<auto Member>
+    std::vector<int64_t>            findRowGroups(RecordDetail::TypeOf<Member> low, RecordDetail::TypeOf<Member> high) const;
+    template<auto Member, typename F>
+    int64_t                         scan(RecordDetail::TypeOf<Member> low, RecordDetail::TypeOf<Member> high, F &&visit);
+
+private:
+    // helper functions
+
+    template<size_t I>
+    std::span<const ColumnDetail::Value<typename Fields::template FieldType<I>>> readChunk(int64_t group);
+    template<size_t I>
+    std::span<const std::string_view> readViews(int64_t group);
+    template<size_t I>
+    void                            fillRows(int64_t group, std::vector<Type> &rows);
+    template<size_t... I>
+    void                            fillAll(int64_t group, std::vector<Type> &rows, std::index_sequence<I...>);
+    template<size_t... I>
+    void                            readZoneMaps(std::index_sequence<I...>);
+    void                            checkGroup(int64_t group) const;
+
+    // member variables
+
+    DataFile                       *file_;
+    int64_t                         rows_;
+    bool                            zone_maps_;
+    std::vector<ColumnDetail::RowGroup> groups_;
+    ColumnDetail::ZoneMapsOf<Fields> stats_;
+    ColumnDetail::ColumnsOf<Fields> columns_;
+    std::array<int64_t, Fields::field_count> loaded_;   // row group in each buffer, or -1
+    std::array<std::unique_ptr<ColumnDetail::StringChunk>, Fields::field_count> strings_;
+
+};
+
+/***** COLUMN WRITER *****/
+
+template<typename Fields>
+ColumnWriter<Fields>::ColumnWriter(DataFile &file, int64_t row_group_size):
+    file_(&file),
+    row_group_size_(row_group_size),
+    pos_(file.getFileSize()),
+    buffered_(0),
+    rows_(0),
+    finished_(false),
+    zone_maps_(false) {
+    encodings_.fill(ColumnEncoding::plain);
+    if (row_group_size <= 0)
+        throw std::invalid_argument("Row group size is out of range.");
+}
+
+// Finishes the file if finish() was not called. Errors are swallowed; call
+// finish() to see them.
+template<typename Fields>
+ColumnWriter<Fields>::~ColumnWriter() {
+    try {
+        if (!finished_)
+            finish();
+    } catch (...) { }
+}
+
+// Sets how the chunks of field Member written from now on are stored. Only
+// integer fields and arrays of integers can be delta or frame-of-reference
+// encoded, and only std::string fields dictionary encoded.
+template<typename Fields>
+template<auto Member>
+void ColumnWriter<Fields>::setEncoding(ColumnEncoding encoding) {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    static_assert(index < Fields::field_count, "Member is not a field of this record.");
+
+    if (!ColumnDetail::supports<typename Fields::template FieldType<index>>(encoding))
+        throw std::invalid_argument("Field cannot be stored with this column encoding.");
+    encodings_[index] = encoding;
+}
+
+// Keeps the range of every integer and floating-point field of each row group
+// in the footer. Only row groups written from now on get an entry, so call it
+// before the first flush.
+template<typename Fields>
+void ColumnWriter<Fields>::enableZoneMaps() {
+    if (!groups_.empty())
+        throw std::runtime_error("Zone maps must be enabled before the first row group.");
+    zone_maps_ = true;
+}
+
+// Buffers one row, writing a row group once row_group_size rows are buffered.
+template<typename Fields>
+void ColumnWriter<Fields>::write(const Type &row) {
+    if (finished_)
+        throw std::runtime_error("Column file is already finished.");
+
+    appendRow(row, std::make_index_sequence<Fields::field_count>());
+    ++buffered_;
+    ++rows_;
+    if (buffered_ == row_group_size_)
+        flush();
+}
+
+template<typename Fields>
+void ColumnWriter<Fields>::write(const Type *rows, int64_t count) {
+    for (int64_t i = 0; i < count; ++i)
+        write(rows[i]);
+}
+
+// Writes the buffered rows as a row group, even if it is not full.
+template<typename Fields>
+void ColumnWriter<Fields>::flush() {
+    if (buffered_ == 0)
+        return;
+
+    ColumnDetail::RowGroup group = {buffered_, {}};
+    group.chunks.reserve(Fields::field_count);
+    writeChunks(group, std::make_index_sequence<Fields::field_count>());
+    groups_.push_back(std::move(group));
+    buffered_ = 0;
+}
+
+// Writes the last row group and the footer. Nothing can be written after.
+template<typename Fields>
+void ColumnWriter<Fields>::finish() {
+    if (finished_)
+        return;
+
+    flush();
+    writeFooter();
+    finished_ = true;
+}
+
+template<typename Fields>
+int64_t ColumnWriter<Fields>::getRowCount() const { return rows_; }
+
+// Returns the number of row groups written so far.
+template<typename Fields>
+int64_t ColumnWriter<Fields>::getRowGroupCount() const { return static_cast<int64_t>(groups_.size()); }
+
+template<typename Fields>
+template<size_t... I>
+void ColumnWriter<Fields>::appendRow(const Type &row, std::index_sequence<I...>) {
+    auto append = [this](auto &column, const auto &value) {
+        using T = std::remove_cvref_t<decltype(value)>;
+        if constexpr (RecordDetail::is_fixed<T>) {
+            if (column.empty())
+                column.reserve(static_cast<size_t>(row_group_size_ * ColumnDetail::extent<T>));
+            size_t used = column.size();
+            column.resize(used + ColumnDetail::extent<T>);
+            std::memcpy(column.data() + used, &value, sizeof(T));
+        } else {
+            column.push_back(value);
+        }
+    };
+
+    (append(std::get<I>(columns_), row.*Fields::template member<I>), ...);
+}
+
+template<typename Fields>
+template<size_t... I>
+void ColumnWriter<Fields>::writeChunks(ColumnDetail::RowGroup &group, std::index_sequence<I...>) {
+    (writeChunk<I>(group), ...);
+}
+
+// Writes the buffered values of field I as one chunk at pos_.
+template<typename Fields>
+template<size_t I>
+void ColumnWriter<Fields>::writeChunk(ColumnDetail::RowGroup &group) {
+    using T = typename Fields::template FieldType<I>;
+    auto &column = std::get<I>(columns_);
+
+    if constexpr (ColumnDetail::has_stats<T>) {
+        if (zone_maps_)
+            std::get<I>(stats_).push_back(ColumnDetail::computeStats(column));
+    }
+
+    ColumnEncoding encoding = encodings_[I];
+    if constexpr (ColumnDetail::is_packable<T>) {
+        if (encoding != ColumnEncoding::plain)
+            file_->writePackedArray(column.data(), static_cast<int64_t>(column.size()),
+                                    static_cast<IntEncoding>(encoding), pos_);
+        else
+            file_->writeArray(column.data(), static_cast<int64_t>(column.size()), pos_);
+    } else if constexpr (RecordDetail::is_fixed<T>) {
+        file_->writeArray(column.data(), static_cast<int64_t>(column.size()), pos_);
+    } else {
+        file_->setWritePos(pos_);
+        if constexpr (ColumnDetail::is_string<T>) {
+            if (encoding == ColumnEncoding::dictionary) {
+                writeDictionary(column);
+            } else {
+                for (const T &value : column)
+                    file_->write(value);
+            }
+        } else {
+            for (const T &value : column)
+                file_->write(value);
+        }
+    }
+    if (file_->fail())
+        throw std::runtime_error("Failed to write a column chunk.");
+
+    int64_t end = file_->getWritePos();
+    group.chunks.push_back({pos_, end - pos_, encoding});
+    pos_ = end;
+    column.clear();
+}
+
+// Writes a uint32_t entry count, each distinct string once in order of first
+// use, then the packed code of every row.
+template<typename Fields>
+void ColumnWriter<Fields>::writeDictionary(const std::vector<std::string> &column) {
+    std::unordered_map<std::string_view, uint32_t> codes_by_string;
+    std::vector<const std::string*> entries;
+    std::vector<uint32_t> codes(column.size());
+    for (size_t r = 0; r < column.size(); ++r) {
+        auto [entry, added] = codes_by_string.try_emplace(column[r], static_cast<uint32_t>(entries.size()));
+        if (added)
+            entries.push_back(&column[r]);
+        codes[r] = entry->second;
+    }
+
+    uint32_t count = static_cast<uint32_t>(entries.size());
+    file_->write(&count);
+    for (const std::string *entry : entries)
+        file_->write(*entry);
+    file_->writePackedArray(codes.data(), static_cast<int64_t>(codes.size()), IntEncoding::frame_of_reference);
+}
+
+template<typename Fields>
+void ColumnWriter<Fields>::writeFooter() {
+    uint64_t schema_hash = Fields::schema_hash;
+    uint32_t column_count = static_cast<uint32_t>(Fields::field_count);
+    int64_t group_count = static_cast<int64_t>(groups_.size());
+
+    file_->setWritePos(pos_);
+    file_->write(&schema_hash);
+    file_->write(&column_count);
+    file_->write(&group_count);
+    for (const ColumnDetail::RowGroup &group : groups_) {
+        file_->write(&group.rows);
+        for (const ColumnDetail::Chunk &chunk : group.chunks) {
+            uint32_t encoding = static_cast<uint32_t>(chunk.encoding);
+            file_->write(&chunk.offset);
+            file_->write(&chunk.size);
+            file_->write(&encoding);
+        }
+    }
+
+    if (zone_maps_) {
+        file_->write(&ColumnDetail::zone_map_magic);
+        writeZoneMaps(std::make_index_sequence<Fields::field_count>());
+    }
+
+    // trailer
+    file_->write(&pos_);
+    file_->write(&ColumnDetail::magic);
+    if (file_->fail())
+        throw std::runtime_error("Failed to write the column file footer.");
+    pos_ = file_->getWritePos();
+}
+
+// Writes the zone map entries of every row group, fields in order.
+template<typename Fields>
+template<size_t... I>
+void ColumnWriter<Fields>::writeZoneMaps(std::index_sequence<I...>) {
+    auto write = [this](const auto &column_stats, size_t group) {
+        using S = typename std::remove_cvref_t<decltype(column_stats)>::value_type;
+        if constexpr (!std::is_same_v<S, std::monostate>) {
+            const S &stats = column_stats[group];
+            file_->write(&stats.min);
+            file_->write(&stats.max);
+            file_->write(&stats.null_count);
+        }
+    };
+
+    for (size_t g = 0; g < groups_.size(); ++g)
+        (write(std::get<I>(stats_), g), ...);
+}
+
+/***** COLUMN READER *****/
+
+// Reads the footer of file.
+//
+// Throws std::runtime_error if file was not written by a ColumnWriter for the
+// same Fields, or its footer is damaged.
+template<typename Fields>
+ColumnReader<Fields>::ColumnReader(DataFile &file):
+    file_(&file),
+    rows_(0),
+    zone_maps_(false) {
+    loaded_.fill(-1);
+
+    // trailer
+    int64_t size = file.getFileSize();
+    int64_t footer_offset = 0;
+    uint32_t magic = 0;
+    if (size >= ColumnDetail::trailer_size) {
+        file.read(&footer_offset, size - ColumnDetail::trailer_size);
+        file.read(&magic);
+    }
+    if (magic != ColumnDetail::magic)
+        throw std::runtime_error("File is not a column file.");
+    if (footer_offset < 0 || footer_offset > size - ColumnDetail::trailer_size - 20)
+        throw std::runtime_error("Column file footer is damaged.");
+
+    // footer
+    uint64_t schema_hash;
+    uint32_t column_count;
+    int64_t group_count;
+    file.read(&schema_hash, footer_offset);
+    file.read(&column_count);
+    file.read(&group_count);
+    if (schema_hash != Fields::schema_hash || column_count != Fields::field_count)
+        throw std::runtime_error("Column file has a different schema.");
+
+    int64_t group_size = 8 + static_cast<int64_t>(Fields::field_count) * ColumnDetail::chunk_entry_size;
+    if (group_count < 0 || group_count > (size - footer_offset) / group_size)
+        throw std::runtime_error("Column file footer is damaged.");
+
+    groups_.resize(static_cast<size_t>(group_count));
+    for (ColumnDetail::RowGroup &group : groups_) {
+        file.read(&group.rows);
+        group.chunks.resize(Fields::field_count);
+        for (ColumnDetail::Chunk &chunk : group.chunks) {
+            uint32_t encoding;
+            file.read(&chunk.offset);
+            file.read(&chunk.size);
+            file.read(&encoding);
+            if (chunk.offset < 0 || chunk.size < 0 || chunk.offset > footer_offset ||
+                chunk.size > footer_offset - chunk.offset ||
+                encoding > static_cast<uint32_t>(ColumnEncoding::dictionary))
+                throw std::runtime_error("Column file footer is damaged.");
+            chunk.encoding = static_cast<ColumnEncoding>(encoding);
+        }
+        if (group.rows < 0)
+            throw std::runtime_error("Column file footer is damaged.");
+        for (const ColumnDetail::Chunk &chunk : group.chunks) {
+            if (group.rows > ColumnDetail::maxRows(chunk))
+                throw std::runtime_error("Column file footer is damaged.");
+        }
+        rows_ += group.rows;
+    }
+
+    // zone maps, if the writer kept them
+    int64_t zone_map_offset = file.getReadPos();
+    if (zone_map_offset + 4 <= size - ColumnDetail::trailer_size) {
+        uint32_t zone_map_magic;
+        file.read(&zone_map_magic);
+        if (zone_map_magic != ColumnDetail::zone_map_magic)
+            throw std::runtime_error("Column file footer is damaged.");
+        if (group_count * ColumnDetail::zone_map_group_size<Fields> > size - ColumnDetail::trailer_size - zone_map_offset - 4)
+            throw std::runtime_error("Column file footer is damaged.");
+        readZoneMaps(std::make_index_sequence<Fields::field_count>());
+        zone_maps_ = true;
+    }
+}
+
+template<typename Fields>
+int64_t ColumnReader<Fields>::getRowCount() const { return rows_; }
+
+template<typename Fields>
+int64_t ColumnReader<Fields>::getRowGroupCount() const { return static_cast<int64_t>(groups_.size()); }
+
+template<typename Fields>
+int64_t ColumnReader<Fields>::getRowGroupRows(int64_t group) const {
+    checkGroup(group);
+    return groups_[group].rows;
+}
+
+template<typename Fields>
+bool ColumnReader<Fields>::hasZoneMaps() const { return zone_maps_; }
+
+// Returns the zone map entry of field Member in a row group.
+//
+// Throws std::runtime_error if the file has no zone maps.
+template<typename Fields>
+template<auto Member>
+ColumnStats<RecordDetail::TypeOf<Member>> ColumnReader<Fields>::getStats(int64_t group) const {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    static_assert(index < Fields::field_count, "Member is not a field of this record.");
+    static_assert(ColumnDetail::has_stats<RecordDetail::TypeOf<Member>>,
+                  "Only integer and floating-point fields have zone map entries.");
+    checkGroup(group);
+
+    if (!zone_maps_)
+        throw std::runtime_error("Column file has no zone maps.");
+    return std::get<index>(stats_)[group];
+}
+
+// Returns the values of field Member in a row group.
+template<typename Fields>
+template<auto Member>
+auto ColumnReader<Fields>::readColumn(int64_t group) {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    static_assert(index < Fields::field_count, "Member is not a field of this record.");
+    return readChunk<index>(group);
+}
+
+// Returns the values of std::string field Member in a row group as views.
+// The views stay valid until another row group of the same field is read.
+template<typename Fields>
+template<auto Member>
+std::span<const std::string_view> ColumnReader<Fields>::readStrings(int64_t group) {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    static_assert(index < Fields::field_count, "Member is not a field of this record.");
+    static_assert(ColumnDetail::is_string<typename Fields::template FieldType<index>>,
+                  "readStrings() can only read std::string fields.");
+    return readViews<index>(group);
+}
+
+// Fills the given fields of the rows of a row group, or every field if none
+// are given. rows is resized to the number of rows in the group; fields that
+// are not read keep their values.
+template<typename Fields>
+template<auto... Members>
+void ColumnReader<Fields>::readRows(int64_t group, std::vector<Type> &rows) {
+    checkGroup(group);
+    rows.resize(static_cast<size_t>(groups_[group].rows));
+
+    if constexpr (sizeof...(Members) == 0) {
+        fillAll(group, rows, std::make_index_sequence<Fields::field_count>());
+    } else {
+        static_assert(((Fields::template indexOf<Members>() < Fields::field_count) && ...),
+                      "Member is not a field of this record.");
+        (fillRows<Fields::template indexOf<Members>()>(group, rows), ...);
+    }
+}
+
+// Returns the row groups that may hold a value of field Member between low and
+// high, inclusive. Without zone maps every row group may.
+template<typename Fields>
+template<auto Member>
+std::vector<int64_t> ColumnReader<Fields>::findRowGroups(RecordDetail::TypeOf<Member> low,
+                                                         RecordDetail::TypeOf<Member> high) const {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    static_assert(index < Fields::field_count, "Member is not a field of this record.");
+    static_assert(ColumnDetail::has_stats<RecordDetail::TypeOf<Member>>,
+                  "Only integer and floating-point fields can be scanned.");
+
+    std::vector<int64_t> found;
+    for (int64_t g = 0; g < getRowGroupCount(); ++g) {
+        if (zone_maps_) {
+            const auto &stats = std::get<index>(stats_)[g];
+            bool only_nulls = stats.null_count == stats.rows;
+            if (only_nulls || stats.max < low || stats.min > high)
+                continue;
+        }
+        found.push_back(g);
+    }
+    return found;
+}
+
+// Calls visit with every row whose field Member is between low and high,
+// inclusive, in file order. Returns the number of rows visited.
+//
+// Only the row groups findRowGroups() returns are read, and of those only the
+// ones with a matching value are read in full.
+template<typename Fields>
+template<auto Member, typename F>
+int64_t ColumnReader<Fields>::scan(RecordDetail::TypeOf<Member> low, RecordDetail::TypeOf<Member> high, F &&visit) {
+    constexpr size_t index = Fields::template indexOf<Member>();
+    auto matches = [low, high](RecordDetail::TypeOf<Member> value) { return low <= value && value <= high; };
+
+    int64_t visited = 0;
+    std::vector<Type> rows;
+    for (int64_t g : findRowGroups<Member>(low, high)) {
+        // the zone map only bounds the chunk; its values decide
+        auto values = readChunk<index>(g);
+        if (std::none_of(values.begin(), values.end(), matches))
+            continue;
+
+        readRows(g, rows);
+        for (const Type &row : rows) {
+            if (matches(row.*Member)) {
+                visit(row);
+                ++visited;
+            }
+        }
+    }
+    return visited;
+}
+
+// Reads the chunk of field I in a row group, unless it is already buffered.
+template<typename Fields>
+template<size_t I>
+std::span<const ColumnDetail::Value<typename Fields::template FieldType<I>>> ColumnReader<Fields>::readChunk(int64_t group) {
+    using T = typename Fields::template FieldType<I>;
+    checkGroup(group);
+
+    auto &column = std::get<I>(columns_);
+    if (loaded_[I] != group) {
+        loaded_[I] = -1;
+        const ColumnDetail::Chunk &chunk = groups_[group].chunks[I];
+        int64_t rows = groups_[group].rows;
+
+        if (!ColumnDetail::supports<T>(chunk.encoding))
+            throw std::runtime_error("Column file footer is damaged.");
+
+        if constexpr (RecordDetail::is_fixed<T>) {
+            int64_t len = rows * ColumnDetail::extent<T>;
+            if constexpr (ColumnDetail::is_packable<T>) {
+                if (chunk.encoding != ColumnEncoding::plain) {
+                    column.resize(static_cast<size_t>(len));
+                    file_->readPackedArray(column.data(), len, chunk.offset);
+                    loaded_[I] = group;
+                    return std::span<const ColumnDetail::Value<T>>(column);
+                }
+            }
+            if (chunk.size != len * static_cast<int64_t>(sizeof(ColumnDetail::Element<T>)))
+                throw std::runtime_error("Column file footer is damaged.");
+            column.resize(static_cast<size_t>(len));
+            file_->readArray(column.data(), len, chunk.offset);
+        } else {
+            column.resize(static_cast<size_t>(rows));
+            if constexpr (ColumnDetail::is_string<T>) {
+                if (chunk.encoding == ColumnEncoding::dictionary) {
+                    std::span<const std::string_view> views = readViews<I>(group);
+                    for (int64_t r = 0; r < rows; ++r)
+                        column[r].assign(views[r]);
+                    loaded_[I] = group;
+                    return std::span<const ColumnDetail::Value<T>>(column);
+                }
+            }
+            file_->setReadPos(chunk.offset);
+            for (T &value : column)
+                file_->read(value);
+        }
+        loaded_[I] = group;
+    }
+
+    return std::span<const ColumnDetail::Value<T>>(column);
+}
+
+// Reads the chunk of string field I in a row group into its arena, unless it
+// is already there.
+template<typename Fields>
+template<size_t I>
+std::span<const std::string_view> ColumnReader<Fields>::readViews(int64_t group) {
+    using T = typename Fields::template FieldType<I>;
+    checkGroup(group);
+
+    if (!strings_[I])
+        strings_[I] = std::make_unique<ColumnDetail::StringChunk>();
+    ColumnDetail::StringChunk &strings = *strings_[I];
+
+    if (strings.group != group) {
+        strings.group = -1;
+        strings.arena.reset();
+        const ColumnDetail::Chunk &chunk = groups_[group].chunks[I];
+        int64_t rows = groups_[group].rows;
+        if (!ColumnDetail::supports<T>(chunk.encoding))
+            throw std::runtime_error("Column file footer is damaged.");
+
+        strings.views.resize(static_cast<size_t>(rows));
+        file_->setReadPos(chunk.offset);
+        if (chunk.encoding == ColumnEncoding::dictionary) {
+            // each distinct string once, then a code per row
+            uint32_t count;
+            file_->read(&count);
+            if (count > rows)
+                throw std::runtime_error("Column file footer is damaged.");
+            strings.dictionary.resize(count);
+            for (std::string_view &entry : strings.dictionary)
+                file_->read(entry, strings.arena);
+
+            strings.codes.resize(static_cast<size_t>(rows));
+            file_->readPackedArray(strings.codes.data(), rows);
+            for (int64_t r = 0; r < rows; ++r) {
+                if (strings.codes[r] >= count)
+                    throw std::runtime_error("Column file footer is damaged.");
+                strings.views[r] = strings.dictionary[strings.codes[r]];
+            }
+        } else {
+            for (std::string_view &view : strings.views)
+                file_->read(view, strings.arena);
+        }
+        strings.group = group;
+    }
+
+    return strings.views;
+}
+
+template<typename Fields>
+template<size_t I>
+void ColumnReader<Fields>::fillRows(int64_t group, std::vector<Type> &rows) {
+    using T = typename Fields::template FieldType<I>;
+    auto values = readChunk<I>(group);
+
+    for (size_t r = 0; r < rows.size(); ++r) {
+        if constexpr (RecordDetail::is_fixed<T>)
+            std::memcpy(&(rows[r].*Fields::template member<I>), values.data() + r * ColumnDetail::extent<T>, sizeof(T));
+        else
+            rows[r].*Fields::template member<I> = values[r];
+    }
+}
+
+template<typename Fields>
+template<size_t... I>
+void ColumnReader<Fields>::fillAll(int64_t group, std::vector<Type> &rows, std::index_sequence<I...>) {
+    (fillRows<I>(group, rows), ...);
+}
+
+// Reads the zone map entries of every row group, fields in order.
+template<typename Fields>
+template<size_t... I>
+void ColumnReader<Fields>::readZoneMaps(std::index_sequence<I...>) {
+    auto read = [this](auto &column_stats, const ColumnDetail::RowGroup &group) {
+        using S = typename std::remove_cvref_t<decltype(column_stats)>::value_type;
+        if constexpr (!std::is_same_v<S, std::monostate>) {
+            S stats = {};
+            file_->read(&stats.min);
+            file_->read(&stats.max);
+            file_->read(&stats.null_count);
+            if (stats.null_count < 0 || stats.null_count > group.rows)
+                throw std::runtime_error("Column file footer is damaged.");
+            stats.rows = group.rows;
+            column_stats.push_back(stats);
+        }
+    };
+
+    for (const ColumnDetail::RowGroup &group : groups_)
+        (read(std::get<I>(stats_), group), ...);
+}
+
+template<typename Fields>
+void ColumnReader<Fields>::checkGroup(int64_t group) const {
+    if (group < 0 || group >= static_cast<int64_t>(groups_.size()))
+        throw std::out_of_range("Row group is out of range.");
+}
+
+
+#endif
@@ -0,0 +1,349 @@
+
+#include "CompressedBuffer.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // little-endian helpers for the index and trailer
+    void putLittle(char *out, uint64_t value, int size) {
+        for (int i = 0; i < size; ++i)
+            out[i] = static_cast<char>(value >> (8 * i));
+    }
+
+    uint64_t getLittle(const char *in, int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+        return value;
+    }
+}
+
+/***** CONSTRUCTORS *****/
+
+// file is the buffer that reaches the disk, and must be open for reading.
+// base is the number of bytes at the start of the file that are left
+// uncompressed. block_size is used for new files; existing files keep the
+// block size they were written with. threads is the number of threads that
+// compress stored blocks; 1 compresses them on the writing thread, and 0
+// uses one per hardware core.
+CompressedBuffer::CompressedBuffer(std::streambuf *file, int64_t base, int64_t block_size, bool writable,
+                                   unsigned int threads, int cached_blocks):
+    BlockBuffer(block_size, 0, writable),
+    file_(file),
+    base_(base),
+    end_(base),
+    changed_(false),
+    cached_blocks_(std::max(cached_blocks, 0)),
+    uses_(0),
+    threads_(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads),
+    stopping_(false),
+    write_failed_(false) { }
+
+// Stops the workers. Blocks that were not appended yet are dropped; call
+// finish() first to keep them.
+CompressedBuffer::~CompressedBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread &worker : workers_)
+        worker.join();
+}
+
+/***** INDEX FUNCTIONS *****/
+
+// Reads the trailer and index of an existing file. A file with nothing past
+// the base bytes starts out empty.
+//
+// Throws std::runtime_error if the file is not block compressed or its index
+// is damaged.
+void CompressedBuffer::load() {
+    std::streamoff file_size = file_->pubseekoff(0, std::ios::end, std::ios::in);
+    if (file_size <= base_) {
+        end_ = base_;
+        return;
+    }
+
+    // trailer
+    char trailer[trailer_size];
+    file_->pubseekpos(file_size - trailer_size, std::ios::in);
+    if (file_size - base_ < trailer_size ||
+        file_->sgetn(trailer, trailer_size) != trailer_size ||
+        getLittle(trailer, 4) != magic)
+        throw std::runtime_error("File is not block compressed.");
+    if (getLittle(trailer + 4, 4) != version)
+        throw std::runtime_error("Compressed file version is not supported.");
+
+    int64_t block_size = static_cast<int64_t>(getLittle(trailer + 8, 4));
+    int64_t size = static_cast<int64_t>(getLittle(trailer + 16, 8));
+    int64_t index_offset = static_cast<int64_t>(getLittle(trailer + 24, 8));
+    if (block_size <= 0)
+        throw std::runtime_error("Compressed file index is damaged.");
+    int64_t count = (size + block_size - 1) / block_size;
+    if (index_offset < base_ || index_offset + count * entry_size != file_size - trailer_size)
+        throw std::runtime_error("Compressed file index is damaged.");
+
+    // index, in one read
+    std::vector<char> bytes(static_cast<size_t>(count * entry_size));
+    file_->pubseekpos(index_offset, std::ios::in);
+    if (file_->sgetn(bytes.data(), static_cast<std::streamsize>(bytes.size())) != static_cast<std::streamsize>(bytes.size()))
+        throw std::runtime_error("Compressed file index is damaged.");
+
+    index_.resize(static_cast<size_t>(count));
+    for (int64_t i = 0; i < count; ++i) {
+        const char *entry = bytes.data() + i * entry_size;
+        index_[i].offset = static_cast<int64_t>(getLittle(entry, 8));
+        index_[i].size = static_cast<uint32_t>(getLittle(entry + 8, 4));
+        index_[i].flags = static_cast<uint32_t>(getLittle(entry + 12, 4));
+        if (index_[i].offset < base_ || index_[i].offset + index_[i].size > index_offset)
+            throw std::runtime_error("Compressed file index is damaged.");
+    }
+
+    reset(block_size, size);
+    end_ = file_size;
+    changed_ = false;
+}
+
+// Stores the buffered block and appends the index and trailer, if anything
+// was written since load().
+//
+// Throws std::ios_base::failure if the file cannot be written.
+void CompressedBuffer::finish() {
+    if (pubsync() != 0)
+        throw std::ios_base::failure("Failed to write a block.");
+    if (!changed_)
+        return;
+
+    int64_t count = static_cast<int64_t>(index_.size());
+    std::vector<char> bytes(static_cast<size_t>(count * entry_size + trailer_size));
+    for (int64_t i = 0; i < count; ++i) {
+        char *entry = bytes.data() + i * entry_size;
+        putLittle(entry, static_cast<uint64_t>(index_[i].offset), 8);
+        putLittle(entry + 8, index_[i].size, 4);
+        putLittle(entry + 12, index_[i].flags, 4);
+    }
+
+    char *trailer = bytes.data() + count * entry_size;
+    putLittle(trailer, magic, 4);
+    putLittle(trailer + 4, version, 4);
+    putLittle(trailer + 8, static_cast<uint64_t>(getBlockSize()), 4);
+    putLittle(trailer + 16, static_cast<uint64_t>(getSize()), 8);
+    putLittle(trailer + 24, static_cast<uint64_t>(end_), 8);
+
+    if (!writeAt(end_, bytes.data(), static_cast<int64_t>(bytes.size())) || file_->pubsync() != 0)
+        throw std::ios_base::failure("Failed to write the compressed file index.");
+
+    end_ += static_cast<int64_t>(bytes.size());
+    changed_ = false;
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+// Returns the buffer below this one.
+std::streambuf *CompressedBuffer::getFile() const { return file_; }
+
+// Returns the number of bytes the file takes on disk, before finish().
+int64_t CompressedBuffer::getStoredSize() const { return end_; }
+
+/***** BLOCK FUNCTIONS *****/
+
+bool CompressedBuffer::writeAt(int64_t pos, const char *data, int64_t len) {
+    if (file_->pubseekpos(pos, std::ios::out) != std::streampos(pos))
+        return false;
+    return file_->sputn(data, len) == len;
+}
+
+// Keeps a copy of a decompressed block, replacing the least recently used
+// one when the cache is full.
+void CompressedBuffer::cacheBlock(int64_t index, const char *data, int64_t len) {
+    if (cached_blocks_ == 0)
+        return;
+
+    CachedBlock *slot = nullptr;
+    for (CachedBlock &cached : cache_) {
+        if (cached.index == index) {
+            slot = &cached;
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        if (static_cast<int>(cache_.size()) < cached_blocks_) {
+            cache_.emplace_back();
+            slot = &cache_.back();
+        } else {
+            slot = &*std::min_element(cache_.begin(), cache_.end(), [](const CachedBlock &a, const CachedBlock &b) {
+                return a.last_use < b.last_use;
+            });
+        }
+    }
+
+    slot->index = index;
+    slot->last_use = ++uses_;
+    slot->data.assign(data, data + len);
+}
+
+// Copies a block that is still waiting to be appended or is in the cache,
+// or reads and decompresses it.
+bool CompressedBuffer::loadBlock(int64_t index, char *data, int64_t len) {
+    for (auto job = pending_.rbegin(); job != pending_.rend(); ++job) {
+        if ((*job)->index == index && static_cast<int64_t>((*job)->data.size()) == len) {
+            std::memcpy(data, (*job)->data.data(), static_cast<size_t>(len));
+            return true;
+        }
+    }
+
+    for (CachedBlock &cached : cache_) {
+        if (cached.index == index && static_cast<int64_t>(cached.data.size()) == len) {
+            std::memcpy(data, cached.data.data(), static_cast<size_t>(len));
+            cached.last_use = ++uses_;
+            return true;
+        }
+    }
+
+    if (index >= static_cast<int64_t>(index_.size()))
+        return false;
+    const Entry &entry = index_[index];
+
+    file_->pubseekpos(entry.offset, std::ios::in);
+    if (entry.flags & stored_raw) {
+        if (entry.size != len || file_->sgetn(data, len) != len)
+            return false;
+    } else {
+        scratch_.resize(entry.size);
+        if (file_->sgetn(scratch_.data(), entry.size) != entry.size ||
+            Lz4::decompress(scratch_.data(), entry.size, data, len) != len)
+            return false;
+    }
+
+    cacheBlock(index, data, len);
+    return true;
+}
+
+// Compresses a block and appends it to the file, or hands it to the
+// compression workers.
+bool CompressedBuffer::storeBlock(int64_t index, const char *data, int64_t len) {
+    if (write_failed_)
+        return false;
+    cacheBlock(index, data, len);
+    if (threads_ > 1)
+        return submitBlock(index, data, len);
+
+    scratch_.resize(static_cast<size_t>(Lz4::bound(len)));
+    int64_t size = Lz4::compress(data, len, scratch_.data(), len - 1);
+    return appendBlock(index, data, len, scratch_.data(), size);
+}
+
+// Appends a block at the end of the file and points its index entry at it,
+// storing it raw if compressing did not make it smaller (packed_size 0).
+bool CompressedBuffer::appendBlock(int64_t index, const char *data, int64_t len,
+                                   const char *packed, int64_t packed_size) {
+    Entry entry = {end_, 0, 0};
+    if (packed_size > 0) {
+        entry.size = static_cast<uint32_t>(packed_size);
+        if (!writeAt(end_, packed, packed_size))
+            return false;
+    } else {
+        entry.size = static_cast<uint32_t>(len);
+        entry.flags = stored_raw;
+        if (!writeAt(end_, data, len))
+            return false;
+    }
+
+    if (index >= static_cast<int64_t>(index_.size()))
+        index_.resize(static_cast<size_t>(index) + 1);
+    index_[index] = entry;
+    end_ += entry.size;
+    changed_ = true;
+    return true;
+}
+
+/***** COMPRESSION POOL *****/
+
+// Copies a block into a job for the workers, then appends the jobs that are
+// finished, waiting for the oldest ones if too many are pending.
+bool CompressedBuffer::submitBlock(int64_t index, const char *data, int64_t len) {
+    if (workers_.empty()) {
+        for (unsigned int i = 0; i < threads_; ++i)
+            workers_.emplace_back(&CompressedBuffer::work, this);
+    }
+
+    std::unique_ptr<Job> job;
+    if (spare_.empty()) {
+        job = std::make_unique<Job>();
+    } else {
+        job = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    job->index = index;
+    job->data.assign(data, data + len);
+    job->packed_size = 0;
+    job->done = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(job.get());
+    }
+    pending_.push_back(std::move(job));
+    work_ready_.notify_one();
+
+    return commitJobs(2 * threads_);
+}
+
+// Appends finished jobs in the order they were submitted until at most keep
+// are pending. Waits for the oldest job only while more than keep are left.
+bool CompressedBuffer::commitJobs(size_t keep) {
+    while (!pending_.empty()) {
+        Job &job = *pending_.front();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!job.done) {
+                if (pending_.size() <= keep)
+                    break;
+                work_done_.wait(lock, [&job] { return job.done; });
+            }
+        }
+
+        if (!appendBlock(job.index, job.data.data(), static_cast<int64_t>(job.data.size()),
+                         job.packed.data(), job.packed_size))
+            write_failed_ = true;
+        spare_.push_back(std::move(pending_.front()));
+        pending_.pop_front();
+    }
+
+    return !write_failed_;
+}
+
+// Worker loop: compresses queued jobs until the buffer is destroyed.
+void CompressedBuffer::work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (stopping_)
+            return;
+
+        Job *job = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+
+        int64_t len = static_cast<int64_t>(job->data.size());
+        job->packed.resize(static_cast<size_t>(Lz4::bound(len)));
+        int64_t size = Lz4::compress(job->data.data(), len, job->packed.data(), len - 1);
+
+        lock.lock();
+        job->packed_size = size;
+        job->done = true;
+        work_done_.notify_all();
+    }
+}
+
+// Stores the buffered block, appends every pending block and flushes the
+// buffer below.
+int CompressedBuffer::sync() {
+    if (BlockBuffer::sync() != 0 || !commitJobs(0))
+        return -1;
+    return file_->pubsync();
+}
@@ -0,0 +1,160 @@
+/**
+ * @file CompressedBuffer.h
+ * @author Danielle Fukunaga
+ * @brief A block stream buffer that stores every block of a file LZ4
+ *        compressed, with an index for random access by logical position.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef COMPRESSED_BUFFER_H
+#define COMPRESSED_BUFFER_H
+
+#include "BlockBuffer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Compresses a file block by block on its way to and from disk.
+ *
+ * The stream sees the uncompressed bytes, split into fixed-size logical
+ * blocks that are compressed independently. Blocks are appended to the file
+ * as they are stored, so rewriting a block leaves its old copy behind. The
+ * file is laid out as:
+ *
+ *     [base bytes] [block] [block] ... [index] [trailer]
+ *
+ * where the base bytes, such as a FileHeader, are not compressed. The index
+ * has one 16 byte entry per logical block: uint64_t file offset, uint32_t
+ * stored size and uint32_t flags (stored_raw if compressing did not help).
+ * The 32 byte trailer holds:
+ *
+ * - 0  uint32_t magic           'DFCZ'
+ *
+ * - 4  uint32_t version
+ *
+ * - 8  uint32_t block size
+ *
+ * - 12 uint32_t reserved
+ *
+ * - 16 uint64_t size            uncompressed size of the stream
+ *
+ * - 24 uint64_t index offset
+ *
+ * all little-endian. finish() appends a new index and trailer after the
+ * blocks written since load(); the old ones are left in place until then, so
+ * the file stays readable if the writer stops early.
+ *
+ * Reading a position decompresses only its block. The last cached_blocks
+ * decompressed blocks are kept, so going back and forth between a few blocks
+ * does not decompress them again.
+ *
+ * With more than one compression thread, stored blocks are handed to a pool
+ * of workers and the writer moves on to the next block right away. Finished
+ * blocks are appended by the writing thread in the order they were stored,
+ * so the file is the same whatever the number of threads. At most two
+ * blocks per worker are waiting at a time; the writer waits for the oldest
+ * one beyond that.
+ *
+ */
+class CompressedBuffer : public BlockBuffer {
+public:
+    CompressedBuffer(std::streambuf *file, int64_t base, int64_t block_size, bool writable,
+                     unsigned int threads = 1, int cached_blocks = default_cached_blocks);
+    ~CompressedBuffer() override;
+
+    void                            load();
+    void                            finish();
+
+    // getters/accessors
+
+    std::streambuf                 *getFile() const;
+    int64_t                         getStoredSize() const;
+
+    // static constants
+
+    static constexpr uint32_t       magic = 0x5A434644;
+    static constexpr uint32_t       version = 1;
+    static constexpr int64_t        trailer_size = 32;
+    static constexpr int64_t        entry_size = 16;
+    static constexpr uint32_t       stored_raw = 0x1;
+    static constexpr int            default_cached_blocks = 8;
+
+protected:
+    // BlockBuffer overrides
+
+    bool                            loadBlock(int64_t index, char *data, int64_t len) override;
+    bool                            storeBlock(int64_t index, const char *data, int64_t len) override;
+    int                             sync() override;
+
+private:
+    struct Entry {
+        int64_t                     offset;         // file position of the stored block
+        uint32_t                    size;           // stored size
+        uint32_t                    flags;
+    };
+
+    struct Job {
+        int64_t                     index;
+        std::vector<char>           data;           // the uncompressed block
+        std::vector<char>           packed;         // compressed bytes, if packed_size > 0
+        int64_t                     packed_size;
+        bool                        done;
+    };
+
+    struct CachedBlock {
+        int64_t                     index;
+        uint64_t                    last_use;
+        std::vector<char>           data;
+    };
+
+    // helper functions
+
+    bool                            writeAt(int64_t pos, const char *data, int64_t len);
+    void                            cacheBlock(int64_t index, const char *data, int64_t len);
+    bool                            appendBlock(int64_t index, const char *data, int64_t len,
+                                                const char *packed, int64_t packed_size);
+    bool                            submitBlock(int64_t index, const char *data, int64_t len);
+    bool                            commitJobs(size_t keep);
+    void                            work();
+
+    // member variables
+
+    std::streambuf                 *file_;          // the buffer below, which reaches the disk
+    int64_t                         base_;          // file position of the first block
+    int64_t                         end_;           // file position where the next block is appended
+    bool                            changed_;       // blocks were stored since load()
+    std::vector<Entry>              index_;
+    std::vector<char>               scratch_;       // compressed bytes of one block
+    std::vector<CachedBlock>        cache_;
+    int                             cached_blocks_;
+    uint64_t                        uses_;          // clock for the least recently used cache entry
+
+    // compression pool
+
+    unsigned int                    threads_;
+    std::vector<std::thread>        workers_;       // started by the first stored block
+    std::deque<std::unique_ptr<Job>> pending_;      // stored blocks not appended yet, oldest first
+    std::vector<std::unique_ptr<Job>> spare_;       // appended jobs, kept for their buffers
+    std::deque<Job*>                queue_;         // jobs no worker has taken yet
+    std::mutex                      mutex_;         // guards queue_, Job::done and stopping_
+    std::condition_variable         work_ready_;
+    std::condition_variable         work_done_;
+    bool                            stopping_;
+    bool                            write_failed_;  // an append failed after its storeBlock returned
+
+};
+
+
+#endif
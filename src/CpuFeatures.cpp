@@ -0,0 +1,51 @@
+
+#include "CpuFeatures.h"
+
+#if defined(DATAFILE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    struct Features {
+        bool                        ssse3 = false;
+        bool                        sse42 = false;
+        bool                        avx2 = false;
+    };
+
+    Features detect() {
+        Features features;
+#if defined(DATAFILE_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        features.ssse3 = (info[2] >> 9) & 1;
+        features.sse42 = (info[2] >> 20) & 1;
+        // the OS must save the ymm registers too
+        bool avx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+        if (avx && max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            features.avx2 = (info[1] >> 5) & 1;
+        }
+#elif defined(DATAFILE_X86)
+        __builtin_cpu_init();
+        features.ssse3 = __builtin_cpu_supports("ssse3");
+        features.sse42 = __builtin_cpu_supports("sse4.2");
+        features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return features;
+    }
+
+    const Features &features() {
+        static const Features detected = detect();
+        return detected;
+    }
+}
+
+/***** FEATURES *****/
+
+bool CpuFeatures::hasSsse3() { return features().ssse3; }
+
+bool CpuFeatures::hasSse42() { return features().sse42; }
+
+bool CpuFeatures::hasAvx2() { return features().avx2; }
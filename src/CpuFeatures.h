@@ -0,0 +1,45 @@
+/**
+ * @file CpuFeatures.h
+ * @author Danielle Fukunaga
+ * @brief Run-time checks for the x86 instruction set extensions that the
+ *        SIMD kernels use.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+
+// On x86 the SIMD kernels are compiled whatever the build flags, each marked
+// with DATAFILE_TARGET for the extensions it needs, and are picked at run
+// time. Builds for a CPU that has the extension, such as -march=native, skip
+// the check.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DATAFILE_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC compiles every intrinsic without flags
+#define DATAFILE_TARGET(features)
+#else
+#define DATAFILE_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+/**
+ * @brief Which instruction set extensions the CPU running the program has.
+ *
+ * Each is looked up once. AVX2 also needs the OS to save the wide registers.
+ * Always false on other architectures.
+ *
+ */
+namespace CpuFeatures {
+    bool                            hasSsse3();
+    bool                            hasSse42();
+    bool                            hasAvx2();
+}
+
+
+#endif
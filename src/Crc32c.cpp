@@ -0,0 +1,135 @@
+#include "Crc32c.h"
+#include "CpuFeatures.h"
+
+#include <array>
+#include <cstring>
+
+// the crc32 instruction is used 8 bytes at a time, so only on x86-64
+#if defined(DATAFILE_X86) && (defined(__x86_64__) || defined(_M_X64))
+#define CRC32C_HARDWARE 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    // CRC-32C polynomial, bit-reversed
+    constexpr uint32_t polynomial = 0x82F63B78;
+
+#if defined(CRC32C_HARDWARE)
+#if defined(__SSE4_2__)
+    constexpr bool has_sse42 = true;
+#else
+    const bool has_sse42 = CpuFeatures::hasSse42();
+#endif
+
+    // Returns a * b modulo the polynomial, both in bit-reversed form.
+    constexpr uint32_t multiplyModP(uint32_t a, uint32_t b) {
+        uint32_t product = 0;
+        for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1) {
+            if (a & bit)
+                product ^= b;
+            b = (b & 1) ? (b >> 1) ^ polynomial : b >> 1;
+        }
+        return product;
+    }
+
+    // Returns x^(8 * bytes) modulo the polynomial, which moves a crc past
+    // that many zero bytes.
+    constexpr uint32_t shiftFor(size_t bytes) {
+        uint32_t result = 1u << 31;         // x^0
+        uint32_t power = 1u << 30;          // x^1
+        for (uint64_t bits = static_cast<uint64_t>(bytes) * 8; bits != 0; bits >>= 1) {
+            if (bits & 1)
+                result = multiplyModP(power, result);
+            power = multiplyModP(power, power);
+        }
+        return result;
+    }
+
+    // bytes per stream in each round of the interleaved loop, large enough
+    // that the two multiplies to combine the streams are noise
+    constexpr size_t stripe = 4096;
+    constexpr uint32_t shift_one = shiftFor(stripe);
+    constexpr uint32_t shift_two = shiftFor(2 * stripe);
+
+    DATAFILE_TARGET("sse4.2")
+    uint32_t updateHardware(uint32_t crc, const unsigned char *data, size_t len) {
+        uint64_t crc0 = crc;
+
+        // three independent streams keep the crc32 unit busy, since each
+        // instruction has a latency of 3 cycles but a throughput of 1
+        while (len >= 3 * stripe) {
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            const unsigned char *end = data + stripe;
+            for (; data < end; data += 8) {
+                uint64_t word0, word1, word2;
+                std::memcpy(&word0, data, 8);
+                std::memcpy(&word1, data + stripe, 8);
+                std::memcpy(&word2, data + 2 * stripe, 8);
+                crc0 = _mm_crc32_u64(crc0, word0);
+                crc1 = _mm_crc32_u64(crc1, word1);
+                crc2 = _mm_crc32_u64(crc2, word2);
+            }
+            crc0 = multiplyModP(shift_two, static_cast<uint32_t>(crc0)) ^
+                   multiplyModP(shift_one, static_cast<uint32_t>(crc1)) ^
+                   static_cast<uint32_t>(crc2);
+            data += 2 * stripe;
+            len -= 3 * stripe;
+        }
+
+        // one stream for the rest
+        for (; len >= 8; data += 8, len -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, 8);
+            crc0 = _mm_crc32_u64(crc0, word);
+        }
+
+        uint32_t crc32 = static_cast<uint32_t>(crc0);
+        for (; len > 0; ++data, --len)
+            crc32 = _mm_crc32_u8(crc32, *data);
+
+        return crc32;
+    }
+#endif
+
+    // slicing-by-8 tables, table[k][b] is the crc of byte b followed by k zero bytes
+    constexpr std::array<std::array<uint32_t, 256>, 8> table = [] {
+        std::array<std::array<uint32_t, 256>, 8> t{};
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; ++i)
+                crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+            t[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b)
+            for (int k = 1; k < 8; ++k)
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+        return t;
+    }();
+
+    uint32_t update(uint32_t crc, const unsigned char *data, size_t len) {
+        // 8 bytes per step, little-endian
+        for (; len >= 8; data += 8, len -= 8) {
+            uint32_t low = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24));
+            crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+                  table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+                  table[3][data[4]] ^ table[2][data[5]] ^
+                  table[1][data[6]] ^ table[0][data[7]];
+        }
+
+        for (; len > 0; ++data, --len)
+            crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xFF];
+
+        return crc;
+    }
+}
+
+/***** CHECKSUMS *****/
+
+uint32_t Crc32c::extend(uint32_t crc, const void *data, size_t len) {
+#if defined(CRC32C_HARDWARE)
+    if (has_sse42)
+        return ~updateHardware(~crc, static_cast<const unsigned char*>(data), len);
+#endif
+    return ~update(~crc, static_cast<const unsigned char*>(data), len);
+}
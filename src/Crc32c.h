@@ -0,0 +1,38 @@
+/**
+ * @file Crc32c.h
+ * @author Danielle Fukunaga
+ * @brief CRC-32C (Castagnoli) checksums for block integrity checks.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief CRC-32C, the checksum used by iSCSI, ext4 and SSE4.2's crc32
+ *        instruction.
+ *
+ * On x86-64 CPUs with SSE4.2, checked at run time, large buffers are
+ * checksummed as three interleaved streams so the crc32 instruction's latency
+ * is hidden, and the three results are combined at the end. Elsewhere a
+ * slicing-by-8 table is used.
+ *
+ */
+namespace Crc32c {
+    // Returns the checksum of len more bytes of data, continuing from crc.
+    uint32_t extend(uint32_t crc, const void *data, size_t len);
+
+    // Returns the checksum of len bytes of data.
+    inline uint32_t compute(const void *data, size_t len) { return extend(0, data, len); }
+}
+
+
+#endif
@@ -1,6 +1,42 @@
 
 
 #include "DataFile.h"
+#include "Varint.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <thread>
+
+namespace {
+    // Returns true if name matches a simple wildcard pattern,
+    // where '*' matches any run of characters and '?' matches any one character.
+    bool matchesPattern(const std::string &name, const std::string &pattern) {
+        size_t n = 0, p = 0;
+        size_t star = std::string::npos, resume = 0;
+
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++n;
+                ++p;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = n;
+            } else if (star != std::string::npos) {
+                p = star + 1;
+                n = ++resume;
+            } else {
+                return false;
+            }
+        }
+
+        while (p < pattern.size() && pattern[p] == '*')
+            ++p;
+
+        return p == pattern.size();
+    }
+}
 
 /***** STATIC CONSTANTS *****/
 
@@ -20,34 +56,166 @@ DataFile::DataFile():
     file_name_(""),
     file_extension_(default_file_extension),
     data_file_(std::make_unique<std::fstream>()),
-    ios_openmode_(std::ios::binary) { }
+    ios_openmode_(std::ios::binary),
+    string_encoding_(StringEncoding::fixed16),
+    byte_order_(ByteOrder::native),
+    swap_bytes_(false),
+    has_header_(false),
+    data_offset_(0),
+    checksum_block_size_(0),
+    compression_block_size_(0),
+    header_compressed_(false),
+    compression_threads_(0),
+    bloom_bits_per_key_(0),
+    bloom_expected_keys_(0) { }
 
 
 DataFile::DataFile(std::string file_name, std::ios::openmode mode):
-    data_file_(std::make_unique<std::fstream>()) {
+    data_file_(std::make_unique<std::fstream>()),
+    string_encoding_(StringEncoding::fixed16),
+    byte_order_(ByteOrder::native),
+    swap_bytes_(false),
+    has_header_(false),
+    data_offset_(0),
+    checksum_block_size_(0),
+    compression_block_size_(0),
+    header_compressed_(false),
+    compression_threads_(0),
+    bloom_bits_per_key_(0),
+    bloom_expected_keys_(0) {
     setFileName(file_name);
     open(file_name_, mode);
 }
 
 DataFile::DataFile(std::string file_name, std::string file_path, std::ios::openmode mode):
     data_file_(std::make_unique<std::fstream>()),
-    file_path_(file_path) {
+    file_path_(file_path),
+    string_encoding_(StringEncoding::fixed16),
+    byte_order_(ByteOrder::native),
+    swap_bytes_(false),
+    has_header_(false),
+    data_offset_(0),
+    checksum_block_size_(0),
+    compression_block_size_(0),
+    header_compressed_(false),
+    compression_threads_(0),
+    bloom_bits_per_key_(0),
+    bloom_expected_keys_(0) {
     setFileName(file_name);
     open(file_name_, mode);
 }
 
+// Move constructor
+//
+// takes over the open fstream along with its position and buffered data,
+// so no I/O is done. other is left without an fstream until it is opened again.
+DataFile::DataFile(DataFile &&other) noexcept:
+    data_file_(std::move(other.data_file_)),
+    file_name_(std::move(other.file_name_)),
+    file_extension_(std::move(other.file_extension_)),
+    file_path_(std::move(other.file_path_)),
+    ios_openmode_(other.ios_openmode_),
+    string_encoding_(other.string_encoding_),
+    byte_order_(other.byte_order_),
+    swap_bytes_(other.swap_bytes_),
+    header_(other.header_),
+    has_header_(other.has_header_),
+    data_offset_(other.data_offset_),
+    checksum_block_size_(other.checksum_block_size_),
+    checksum_buffer_(std::move(other.checksum_buffer_)),
+    compression_block_size_(other.compression_block_size_),
+    header_compressed_(other.header_compressed_),
+    compression_threads_(other.compression_threads_),
+    compressed_buffer_(std::move(other.compressed_buffer_)),
+    bloom_bits_per_key_(other.bloom_bits_per_key_),
+    bloom_expected_keys_(other.bloom_expected_keys_),
+    bloom_filter_(std::move(other.bloom_filter_)) { }
+
 // Make sure file is closed upon destruction of DataFile object
 DataFile::~DataFile() {
-    close();
+    // a destructor cannot throw, so a failure to save checksums is lost here;
+    // call close() first to see it
+    try {
+        close();
+    } catch (const std::exception &) { }
 }
 
+/***** MOVE/SWAP *****/
+
+// Move assignment
+//
+// closes the current file, if any, and takes over other's fstream. As in the
+// destructor, a failure to close is lost here; call close() first to see it.
+DataFile &DataFile::operator=(DataFile &&other) noexcept {
+    if (this != &other) {
+        try {
+            close();
+        } catch (const std::exception &) { }
+        data_file_ = std::move(other.data_file_);
+        file_name_ = std::move(other.file_name_);
+        file_extension_ = std::move(other.file_extension_);
+        file_path_ = std::move(other.file_path_);
+        ios_openmode_ = other.ios_openmode_;
+        string_encoding_ = other.string_encoding_;
+        byte_order_ = other.byte_order_;
+        swap_bytes_ = other.swap_bytes_;
+        header_ = other.header_;
+        has_header_ = other.has_header_;
+        data_offset_ = other.data_offset_;
+        checksum_block_size_ = other.checksum_block_size_;
+        checksum_buffer_ = std::move(other.checksum_buffer_);
+        compression_block_size_ = other.compression_block_size_;
+        header_compressed_ = other.header_compressed_;
+        compression_threads_ = other.compression_threads_;
+        compressed_buffer_ = std::move(other.compressed_buffer_);
+        bloom_bits_per_key_ = other.bloom_bits_per_key_;
+        bloom_expected_keys_ = other.bloom_expected_keys_;
+        bloom_filter_ = std::move(other.bloom_filter_);
+    }
+    return *this;
+}
+
+// Exchanges the files and all associated state without doing any I/O.
+void DataFile::swap(DataFile &other) noexcept {
+    std::swap(data_file_, other.data_file_);
+    std::swap(file_name_, other.file_name_);
+    std::swap(file_extension_, other.file_extension_);
+    std::swap(file_path_, other.file_path_);
+    std::swap(ios_openmode_, other.ios_openmode_);
+    std::swap(string_encoding_, other.string_encoding_);
+    std::swap(byte_order_, other.byte_order_);
+    std::swap(swap_bytes_, other.swap_bytes_);
+    std::swap(header_, other.header_);
+    std::swap(has_header_, other.has_header_);
+    std::swap(data_offset_, other.data_offset_);
+    std::swap(checksum_block_size_, other.checksum_block_size_);
+    std::swap(checksum_buffer_, other.checksum_buffer_);
+    std::swap(compression_block_size_, other.compression_block_size_);
+    std::swap(header_compressed_, other.header_compressed_);
+    std::swap(compression_threads_, other.compression_threads_);
+    std::swap(compressed_buffer_, other.compressed_buffer_);
+    std::swap(bloom_bits_per_key_, other.bloom_bits_per_key_);
+    std::swap(bloom_expected_keys_, other.bloom_expected_keys_);
+    std::swap(bloom_filter_, other.bloom_filter_);
+}
+
+void swap(DataFile &lhs, DataFile &rhs) noexcept { lhs.swap(rhs); }
+
 /***** OPEN/CLOSE FUNCTIONS *****/
 
-void DataFile::open(std::ios::openmode mode) {
+void DataFile::open(std::ios::openmode mode) { openFile(mode, true); }
+
+// Opens the file, creating it first if it cannot be opened and create is
+// true.
+void DataFile::openFile(std::ios::openmode mode, bool create) {
     if (file_name_.empty())
         return;
     
     ios_openmode_ = mode;
+
+    // a moved-from DataFile has no fstream
+    if (!data_file_)
+        data_file_ = std::make_unique<std::fstream>();
     
     // switch (mode) {
     //     case OpenMode::readonly:
@@ -61,18 +229,147 @@ void DataFile::open(std::ios::openmode mode) {
     //         break;
     // }
     
-    data_file_->open(file_path_ + file_name_, ios_openmode_);
+    // checksummed and compressed blocks are read back before they are
+    // rewritten, so the file is opened for reading too, truncating it as
+    // out alone would
+    std::ios::openmode file_mode = ios_openmode_;
+    bool blocks = checksum_block_size_ > 0 || compression_block_size_ > 0;
+    if (blocks && (file_mode & std::ios::out) && !(file_mode & std::ios::in))
+        file_mode |= std::ios::in | std::ios::trunc;
+
+    data_file_->open(file_path_ + file_name_, file_mode);
+
+    if (!data_file_->is_open() && !create)
+        throw std::ios_base::failure("Failed to open the file.");
 
     // if file not opened (doesn't exist), use fstream to open file for writing,
     // which will create a new file if it doesn't already exist
     if (!data_file_->is_open()) {
         data_file_->open(file_name_, std::ios::binary | std::ios::out);
         data_file_->close();
-        data_file_->open(file_path_ + file_name_, ios_openmode_);
+        data_file_->open(file_path_ + file_name_, file_mode);
     }
 
     if (!data_file_->is_open())
         throw std::ios_base::failure("Failed to open or create the file.");
+
+    // the keys of the file, from its sidecar
+    bloom_filter_.reset();
+    if (bloom_bits_per_key_ > 0)
+        openBloomFilter();
+
+    // read and write through the checksummed blocks
+    if (checksum_block_size_ > 0)
+        openChecksums();
+
+    // write or check the header
+    data_offset_ = 0;
+    header_compressed_ = false;
+    if (has_header_)
+        openHeader();
+
+    // read and write through the compressed blocks, after the header
+    if (compression_block_size_ > 0 || header_compressed_)
+        openCompression();
+}
+
+// Writes the header to a new, empty file, or reads and checks the header of
+// an existing file in one small read.
+//
+// Positions are relative to the end of the header, so the header is never
+// visible through the read/write functions. A file that does not match the
+// expected magic, format version or schema hash is closed and
+// std::runtime_error is thrown. Otherwise the byte order and string encoding
+// are taken from the header's flags.
+void DataFile::openHeader() {
+    unsigned char bytes[FileHeader::size] = {0};
+
+    // little-endian helpers for the fixed header layout
+    auto put = [&bytes](int offset, uint64_t value, int size) {
+        for (int i = 0; i < size; ++i)
+            bytes[offset + i] = static_cast<unsigned char>(value >> (8 * i));
+    };
+    auto get = [&bytes](int offset, int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(bytes[offset + i]) << (8 * i);
+        return value;
+    };
+
+    data_file_->seekg(0, std::ios::end);
+    int64_t file_size = static_cast<int64_t>(data_file_->tellg());
+
+    // new file, write the header from the current settings
+    if (file_size == 0 && (ios_openmode_ & std::ios::out)) {
+        bool big_endian = (byte_order_ == ByteOrder::big) ||
+                          (byte_order_ == ByteOrder::native && std::endian::native == std::endian::big);
+        header_.flags = 0;
+        if (big_endian)
+            header_.flags |= HeaderFlags::big_endian;
+        if (string_encoding_ == StringEncoding::varint)
+            header_.flags |= HeaderFlags::varint_strings;
+        if (compression_block_size_ > 0)
+            header_.flags |= HeaderFlags::compressed;
+
+        put(0, header_.magic, 4);
+        put(4, FileHeader::size, 2);
+        put(6, header_.flags, 2);
+        put(8, header_.format_version, 4);
+        put(16, header_.schema_hash, 8);
+
+        data_file_->seekp(0, std::ios::beg);
+        data_file_->write(reinterpret_cast<const char*>(bytes), FileHeader::size);
+        if (data_file_->fail()) {
+            close();
+            throw std::ios_base::failure("Failed to write the file header.");
+        }
+
+        data_offset_ = FileHeader::size;
+        return;
+    }
+
+    // existing file, read and check the header
+    data_file_->seekg(0, std::ios::beg);
+    data_file_->read(reinterpret_cast<char*>(bytes), FileHeader::size);
+    if (data_file_->gcount() != FileHeader::size) {
+        close();
+        throw std::runtime_error("File is too small to have a header.");
+    }
+
+    FileHeader found;
+    found.magic = static_cast<uint32_t>(get(0, 4));
+    found.flags = static_cast<uint16_t>(get(6, 2));
+    found.format_version = static_cast<uint32_t>(get(8, 4));
+    found.schema_hash = get(16, 8);
+
+    const char *mismatch = nullptr;
+    if (found.magic != header_.magic)
+        mismatch = "File header magic number does not match.";
+    else if (get(4, 2) != FileHeader::size)
+        mismatch = "File header size is not supported.";
+    else if (found.format_version > header_.format_version)
+        mismatch = "File format version is newer than supported.";
+    else if (found.schema_hash != header_.schema_hash)
+        mismatch = "File schema hash does not match.";
+    else if (!(found.flags & HeaderFlags::compressed) && compression_block_size_ > 0)
+        mismatch = "File is not block compressed.";
+
+    if (mismatch != nullptr) {
+        close();
+        throw std::runtime_error(mismatch);
+    }
+
+    // pick up how the file was written
+    header_ = found;
+    setByteOrder((found.flags & HeaderFlags::big_endian) ? ByteOrder::big : ByteOrder::little);
+    setStringEncoding((found.flags & HeaderFlags::varint_strings) ? StringEncoding::varint : StringEncoding::fixed16);
+    // a compressed file is read as one for this open only, leaving the
+    // compression settings as they were
+    header_compressed_ = (found.flags & HeaderFlags::compressed) && compression_block_size_ == 0;
+
+    data_offset_ = FileHeader::size;
+    data_file_->seekg(data_offset_, std::ios::beg);
+    data_file_->seekp(data_offset_, std::ios::beg);
 }
 
 void DataFile::open(std::string file_name, std::ios::openmode mode) {
@@ -87,16 +384,102 @@ void DataFile::open(std::string file_name, std::string file_path, std::ios::open
 }
 
 void DataFile::close() {
-    if (data_file_->is_open()) {
+    if (isOpen()) {
+        // finish the block buffers from the top down while the file is
+        // still open: the compressed index first, then the checksums
+        try {
+            if (compressed_buffer_) {
+                compressed_buffer_->finish();
+                static_cast<std::ios&>(*data_file_).rdbuf(compressed_buffer_->getFile());
+                compressed_buffer_.reset();
+            }
+            if (checksum_buffer_) {
+                checksum_buffer_->save();
+                static_cast<std::ios&>(*data_file_).rdbuf(data_file_->rdbuf());
+                checksum_buffer_.reset();
+            }
+        } catch (...) {
+            static_cast<std::ios&>(*data_file_).rdbuf(data_file_->rdbuf());
+            compressed_buffer_.reset();
+            checksum_buffer_.reset();
+            data_file_->close();
+            header_compressed_ = false;
+            throw;
+        }
+
+        data_file_->close();
+        header_compressed_ = false;
+
+        // the sidecar belongs to the file's final size
+        if (bloom_filter_ && (ios_openmode_ & std::ios::out)) {
+            std::error_code error;
+            auto size = std::filesystem::file_size(file_path_ + file_name_, error);
+            if (error)
+                throw std::ios_base::failure("Failed to write the Bloom filter file.");
+            bloom_filter_->save(file_path_ + file_name_ + ".bloom", static_cast<int64_t>(size));
+        }
+    }
+}
+
+// Puts a ChecksumBuffer between the fstream and its file and loads the
+// file's checksums. Closes the file and rethrows if they cannot be loaded.
+void DataFile::openChecksums() {
+    auto buffer = std::make_unique<ChecksumBuffer>(data_file_->rdbuf(), file_path_ + file_name_ + ".crc",
+                                                   checksum_block_size_, (ios_openmode_ & std::ios::out) != 0);
+    try {
+        buffer->load();
+    } catch (...) {
         data_file_->close();
+        throw;
+    }
+
+    static_cast<std::ios&>(*data_file_).rdbuf(buffer.get());
+    checksum_buffer_ = std::move(buffer);
+}
+
+// Puts a CompressedBuffer on top of the file's buffer and loads the
+// compressed file's index. The header, if any, stays uncompressed in front
+// of the blocks, so positions start at 0 again. Closes the file and rethrows
+// if the file is not block compressed.
+void DataFile::openCompression() {
+    int64_t block_size = compression_block_size_ > 0 ? compression_block_size_ : default_compression_block_size;
+    auto buffer = std::make_unique<CompressedBuffer>(streamBuffer(), data_offset_, block_size,
+                                                     (ios_openmode_ & std::ios::out) != 0, compression_threads_);
+    try {
+        buffer->load();
+    } catch (...) {
+        close();
+        throw;
     }
+
+    static_cast<std::ios&>(*data_file_).rdbuf(buffer.get());
+    compressed_buffer_ = std::move(buffer);
+    data_offset_ = 0;
+}
+
+// Loads the Bloom filter of the file from <file>.bloom, or starts an empty
+// one for a new, empty file that is open for writing. A sidecar written for a
+// file of a different size is out of date and is not used; the file then has
+// no filter until it is rewritten from empty.
+void DataFile::openBloomFilter() {
+    std::error_code error;
+    auto size = std::filesystem::file_size(file_path_ + file_name_, error);
+    if (error)
+        return;
+
+    auto filter = std::make_unique<BloomFilter>();
+    if (size == 0 && (ios_openmode_ & std::ios::out))
+        filter = std::make_unique<BloomFilter>(bloom_expected_keys_, bloom_bits_per_key_);
+    else if (!filter->load(file_path_ + file_name_ + ".bloom", static_cast<int64_t>(size)))
+        return;
+    bloom_filter_ = std::move(filter);
 }
 
 /***** GETTERS/ACCESSORS *****/
 
 std::string DataFile::getFileName() const { return file_name_; }
 
-std::string DataFile::getFileExtension() const { return file_extension_.substr(1); }
+std::string DataFile::getFileExtension() const { return file_extension_.empty() ? "" : file_extension_.substr(1); }
 
 std::string DataFile::getFilePath() const { return file_path_; }
 
@@ -113,20 +496,58 @@ int64_t DataFile::getFileSize() const {
     // move back to current position
     data_file_->seekg(curr_pos);
 
-    // return end position, which is the file size in bytes
-    return file_size;
+    // return end position, which is the file size in bytes,
+    // not counting the header
+    return file_size - data_offset_;
 }
 
 // Returns the current std::ios::openmode for the file.
 // If file is closed, returns the last openmode used.
 std::ios_base::openmode DataFile::getOpenMode() const { return ios_openmode_; };
 
+// Returns the encoding used for string length prefixes.
+StringEncoding DataFile::getStringEncoding() const { return string_encoding_; }
+
+// Returns the byte order numbers are stored in.
+ByteOrder DataFile::getByteOrder() const { return byte_order_; }
+
+// Returns the header expected at open, or the header that was read from the
+// file once it is open.
+const FileHeader &DataFile::getHeader() const { return header_; }
+
+// Returns true if the file has a header.
+bool DataFile::hasHeader() const { return has_header_; }
+
+// Returns true if the file is opened with block checksums.
+bool DataFile::hasChecksums() const { return checksum_block_size_ > 0; }
+
+// Returns the number of bytes covered by each checksum, or 0 if checksums
+// are off.
+int64_t DataFile::getChecksumBlockSize() const { return checksum_block_size_; }
+
+// Returns true if the file is opened as compressed blocks.
+bool DataFile::isCompressed() const { return compression_block_size_ > 0 || header_compressed_; }
+
+// Returns the uncompressed size of each block, or 0 if compression is off.
+int64_t DataFile::getCompressionBlockSize() const {
+    if (compressed_buffer_)
+        return compressed_buffer_->getBlockSize();
+    return compression_block_size_;
+}
+
+// Returns true if the file has a Bloom filter that can rule keys out. The
+// filter of the last open stays loaded after close().
+bool DataFile::hasBloomFilter() const { return bloom_filter_ != nullptr; }
+
+// Returns true if numbers are converted between file and host byte order.
+bool DataFile::needsByteSwap() const { return swap_bytes_; }
+
 int64_t DataFile::getReadPos() const {
     // check if file is open, return -1 if it is not
     if (!isOpen())
         return -1;
 
-    return static_cast<int64_t>(data_file_->tellg());
+    return static_cast<int64_t>(data_file_->tellg()) - data_offset_;
 }
 
 int64_t DataFile::getWritePos() const {
@@ -134,7 +555,7 @@ int64_t DataFile::getWritePos() const {
     if (!isOpen())
         return -1;
 
-    return static_cast<int64_t>(data_file_->tellp());
+    return static_cast<int64_t>(data_file_->tellp()) - data_offset_;
 }
 
 /***** SETTERS/MUTATORS *****/
@@ -158,8 +579,9 @@ void DataFile::setFileName(std::string file_name) {
     }
 }
 
+// Replaces the extension of the file name, or removes it if extension is empty.
 void DataFile::setFileExtension(std::string extension) {
-    if (extension[0] != '.') {
+    if (!extension.empty() && extension[0] != '.') {
         file_extension_ = "." + extension;
     } else {
         file_extension_ = extension;
@@ -178,6 +600,137 @@ void DataFile::setFilePath(std::string file_path) {
     file_path_ = file_path;
 }
 
+// Sets the encoding used for string length prefixes. Readers must use the
+// same encoding that the file was written with.
+void DataFile::setStringEncoding(StringEncoding encoding) { string_encoding_ = encoding; }
+
+// Sets the byte order numbers are stored in. Readers must use the same byte
+// order that the file was written with.
+void DataFile::setByteOrder(ByteOrder order) {
+    byte_order_ = order;
+    swap_bytes_ = (order == ByteOrder::little && std::endian::native != std::endian::little) ||
+                  (order == ByteOrder::big && std::endian::native != std::endian::big);
+}
+
+// Gives the file a header. Must be called before the file is opened.
+//
+// When a new or empty file is opened, header is written with flags taken from
+// the byte order and string encoding settings. When an existing file is opened,
+// its header must have the same magic and schema hash and a format version no
+// newer than header's, and its flags replace those settings.
+void DataFile::setHeader(const FileHeader &header) {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change the header at this time.");
+
+    header_ = header;
+    has_header_ = true;
+}
+
+// Keeps a CRC-32C checksum for every block_size bytes of the file from the
+// next open on. Must be called before the file is opened.
+//
+// Checksums are computed as blocks are written and kept in a sidecar file,
+// <file>.crc, which is written when the file is closed. Each block is checked
+// when it is first read after being loaded; a read that reaches a corrupt
+// block throws ChecksumError, or returns FileStatus::checksum_error from the
+// try* functions. verify() checks the whole file.
+//
+// Every write to the file must then go through a DataFile with checksums
+// enabled, otherwise the next open throws std::runtime_error.
+void DataFile::enableChecksums(int64_t block_size) {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change checksums at this time.");
+    if (block_size <= 0 || block_size > INT_MAX)
+        throw std::invalid_argument("Checksum block size is out of range.");
+
+    checksum_block_size_ = block_size;
+}
+
+// Opens the file without checksums from now on.
+void DataFile::disableChecksums() {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change checksums at this time.");
+
+    checksum_block_size_ = 0;
+}
+
+// Stores the file as independently LZ4 compressed blocks of block_size bytes
+// from the next open on. Must be called before the file is opened.
+//
+// Positions, sizes and every read and write function work on the
+// uncompressed bytes. Reading a position decompresses only the block it is
+// in, and a few recently used blocks are kept decompressed. Existing files
+// keep the block size they were written with. Opening a file that is not
+// block compressed throws std::runtime_error.
+//
+// Blocks are appended when they are written, so rewriting data in place
+// grows the file; the index that finds them is written when the file is
+// closed.
+//
+// Full blocks are compressed on threads worker threads while the writer
+// fills the next ones, and appended in order, so the file does not depend on
+// the thread count. If threads is 0, one thread per hardware core is used;
+// 1 compresses on the writing thread. Workers only start once a block is
+// written.
+void DataFile::enableCompression(int64_t block_size, unsigned int threads) {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change compression at this time.");
+    if (block_size <= 0 || block_size > INT_MAX)
+        throw std::invalid_argument("Compression block size is out of range.");
+
+    compression_block_size_ = block_size;
+    compression_threads_ = threads;
+}
+
+// Opens the file without compression from now on.
+void DataFile::disableCompression() {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change compression at this time.");
+
+    compression_block_size_ = 0;
+}
+
+// Keeps a Bloom filter of the keys added with addKey() in a sidecar file,
+// <file>.bloom, from the next open on, so mayContainKey() can rule a file out
+// without reading it. Must be called before the file is opened.
+//
+// A new file starts an empty filter sized for expected_keys keys at
+// bits_per_key bits each (about 1% false positives at 10); both must be
+// positive. An existing file loads its filter at the size it was saved with,
+// so readers can keep the defaults. The filter is written when the file is
+// closed and loaded when it is opened again, and stays loaded after close().
+// Every key written to the file must then be added through a DataFile with
+// the filter enabled. An existing file whose sidecar is missing or out of
+// date has no filter, and every key may be in it.
+void DataFile::enableBloomFilter(int64_t expected_keys, int bits_per_key) {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change the Bloom filter at this time.");
+    if (expected_keys <= 0 || bits_per_key <= 0)
+        throw std::invalid_argument("Bloom filter size is out of range.");
+
+    bloom_expected_keys_ = expected_keys;
+    bloom_bits_per_key_ = bits_per_key;
+}
+
+// Opens the file without a Bloom filter from now on.
+void DataFile::disableBloomFilter() {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change the Bloom filter at this time.");
+
+    bloom_bits_per_key_ = 0;
+    bloom_filter_.reset();
+}
+
+// Opens files without a header from now on.
+void DataFile::clearHeader() {
+    if (isOpen())
+        throw std::runtime_error("File is already open. Cannot change the header at this time.");
+
+    header_ = FileHeader();
+    has_header_ = false;
+    data_offset_ = 0;
+}
+
 void DataFile::setReadPos(int64_t pos) {
     // check if file is open
     if (!isOpen())
@@ -189,7 +742,10 @@ void DataFile::setReadPos(int64_t pos) {
         throw std::out_of_range("Position is out of bounds.");
 
     // move pointer
-    data_file_->seekg(pos, (pos < 0 ? std::ios::end : std::ios::beg));
+    if (pos < 0)
+        data_file_->seekg(pos, std::ios::end);
+    else
+        data_file_->seekg(pos + data_offset_, std::ios::beg);
 }
 
 void DataFile::setReadPosBegin() {
@@ -197,7 +753,7 @@ void DataFile::setReadPosBegin() {
     if (!isOpen())
         throw std::runtime_error("File is not open.");
     
-    data_file_->seekg(0, std::ios::beg);
+    data_file_->seekg(data_offset_, std::ios::beg);
 }
 void DataFile::setReadPosEnd() {
     // check if file is open
@@ -218,7 +774,10 @@ void DataFile::setWritePos(int64_t pos) {
         throw std::out_of_range("Position is out of bounds.");
 
     // move pointer
-    data_file_->seekp(pos, (pos < 0 ? std::ios::end : std::ios::beg));
+    if (pos < 0)
+        data_file_->seekp(pos, std::ios::end);
+    else
+        data_file_->seekp(pos + data_offset_, std::ios::beg);
 }
 
 void DataFile::setWritePosBegin() {
@@ -226,7 +785,7 @@ void DataFile::setWritePosBegin() {
     if (!isOpen())
         throw std::runtime_error("File is not open.");
     
-    data_file_->seekp(0, std::ios::beg);
+    data_file_->seekp(data_offset_, std::ios::beg);
 }
 
 void DataFile::setWritePosEnd() {
@@ -242,33 +801,38 @@ void DataFile::setWritePosEnd() {
 
 // Wrapper for std::fstream.is_open().
 // Returns true if file is open.
-bool DataFile::isOpen() const { return data_file_->is_open(); }
+bool DataFile::isOpen() const { return data_file_ && data_file_->is_open(); }
 
 // Wrapper for std::fstream.eof().
 // Returns true if eofbit is set.
-bool DataFile::eof() const { return data_file_->eof(); }
+bool DataFile::eof() const { return data_file_ && data_file_->eof(); }
 
 // Wrapper for std::fstream.good().
 // Returns true if no error flags are set.
-bool DataFile::good() const { return data_file_->good(); }
+bool DataFile::good() const { return data_file_ && data_file_->good(); }
 
 // Wrapper for std::fstream.fail().
 // Returns true if either badbit or failbit are set.
-bool DataFile::fail() const { return data_file_->fail(); }
+bool DataFile::fail() const { return !data_file_ || data_file_->fail(); }
 
 // Wrapper for std::fstream.bad().
 // Returns true if badbit is set.
-bool DataFile::bad() const { return data_file_->bad(); }
+bool DataFile::bad() const { return data_file_ && data_file_->bad(); }
 
 // Wrapper for std::fstream.clear().
 // Resets the error state.
 // Does not support setting specific error bits.
-void DataFile::clear() { data_file_->clear(); }
+void DataFile::clear() {
+    if (data_file_)
+        data_file_->clear();
+}
 
 /***** READ FUNCTIONS *****/
 
 
-void DataFile::read(std::string &str) {
+// Shared by the std::string and std::pmr::string reads.
+template<typename S>
+void DataFile::readString(S &str) {
     // check if file is open
     if (!isOpen())
         throw std::runtime_error("File is not open.");
@@ -277,66 +841,481 @@ void DataFile::read(std::string &str) {
     if (eof())
         throw std::out_of_range("End of file reached.");
 
-    // read string length
-    uint16_t len;
-    read(&len);
+    // read string length, making sure the file holds that many bytes
+    uint64_t len = readLength();
+    if (!fitsInFile(len))
+        throwShortRead();
 
-    // create char buffer and read string into it
-    std::vector<char> buffer(len + 1);
-    readArray(buffer.data(), len);
+    // read string straight into str
+    str.resize(len);
+    readArray(str.data(), len);
 
     // verify that entire string was successfully read
-    if (data_file_->gcount() != len)
+    if (data_file_->gcount() != static_cast<std::streamsize>(len))
         throw std::ios_base::failure("Failed to read the complete string data.");
+}
 
-    // add null terminator to char buffer
-    buffer[len] = '\0';
+// Reads a length-prefixed string directly into str.
+//
+// str is resized once, so its existing capacity is reused and no temporary
+// buffer is allocated. Embedded null characters are kept.
+void DataFile::read(std::string &str) { readString(str); }
 
-    // convert to std::string
-    str = std::string(buffer.data());
+void DataFile::read(std::string &str, int64_t pos) {
+    // move read pointer
+    setReadPos(pos);
+    // read from file
+    read(str);
 }
 
-void DataFile::read(std::string &str, int64_t pos) {
+// Reads a length-prefixed string into a std::pmr::string, so the string
+// data is allocated from the string's memory resource.
+void DataFile::read(std::pmr::string &str) { readString(str); }
+
+void DataFile::read(std::pmr::string &str, int64_t pos) {
     // move read pointer
     setReadPos(pos);
     // read from file
     read(str);
 }
 
-/***** WRITE FUNCTIONS *****/
+// Reads a length-prefixed string into memory taken from arena and points str
+// at it. str stays valid until the arena is reset or destroyed.
+//
+// With a StringArena, once the arena has grown to the size of a batch,
+// reading the next batch after arena.reset() does not allocate.
+void DataFile::read(std::string_view &str, std::pmr::memory_resource &arena) {
+    // check if file is open
+    if (!isOpen())
+        throw std::runtime_error("File is not open.");
+
+    // check if at eof
+    if (eof())
+        throw std::out_of_range("End of file reached.");
+
+    // read string length, making sure the file holds that many bytes
+    uint64_t len = readLength();
+    if (!fitsInFile(len))
+        throwShortRead();
+
+    // read string into the arena
+    char *buffer = static_cast<char*>(arena.allocate(len, 1));
+    readArray(buffer, len);
+
+    // verify that entire string was successfully read
+    if (data_file_->gcount() != static_cast<std::streamsize>(len))
+        throw std::ios_base::failure("Failed to read the complete string data.");
+
+    str = std::string_view(buffer, len);
+}
+
+void DataFile::read(std::string_view &str, std::pmr::memory_resource &arena, int64_t pos) {
+    // move read pointer
+    setReadPos(pos);
+    // read from file
+    read(str, arena);
+}
+
+/***** NON-THROWING READ FUNCTIONS *****/
+
+FileStatus DataFile::tryRead(std::string &str) noexcept {
+    // read string length
+    uint64_t len;
+    FileStatus status = tryReadLength(&len);
+    if (status != FileStatus::ok)
+        return status;
+
+    // a length the file cannot hold is the end of the file, and one that
+    // cannot be allocated is too long; either way the position goes back
+    // before the length
+    FileStatus too_long = fitsInFile(len) ? FileStatus::ok : FileStatus::end_of_file;
+    if (too_long == FileStatus::ok) {
+        try {
+            str.resize(len);
+        } catch (const std::exception &) {
+            too_long = FileStatus::length_error;
+        }
+    }
+    if (too_long != FileStatus::ok) {
+        data_file_->seekg(-static_cast<std::streamoff>(lengthSize(len)), std::ios::cur);
+        return too_long;
+    }
+
+    // read string directly into str
+    data_file_->read(str.data(), len);
+
+    // check for end of file, leaving the read position before the length
+    if (data_file_->gcount() != static_cast<std::streamsize>(len)) {
+        status = undoShortRead(data_file_->gcount());
+        if (status == FileStatus::end_of_file || status == FileStatus::checksum_error)
+            data_file_->seekg(-static_cast<std::streamoff>(lengthSize(len)), std::ios::cur);
+        return status;
+    }
+
+    return FileStatus::ok;
+}
+
+FileStatus DataFile::tryRead(std::string &str, int64_t pos) noexcept {
+    // move read pointer
+    FileStatus status = seekRead(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // read from file
+    return tryRead(str);
+}
+
+/***** NON-THROWING WRITE FUNCTIONS *****/
+
+FileStatus DataFile::tryWrite(const std::string &str) noexcept {
+    // write string length
+    FileStatus status = tryWriteLength(str.length());
+    if (status != FileStatus::ok)
+        return status;
+
+    // write string without null terminator
+    return tryWriteArray(str.data(), static_cast<int64_t>(str.length()));
+}
+
+FileStatus DataFile::tryWrite(const std::string &str, int64_t pos) noexcept {
+    // move write pointer
+    FileStatus status = seekWrite(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // write to file
+    return tryWrite(str);
+}
+
+/***** NON-THROWING HELPER FUNCTIONS *****/
+
+// Non-throwing version of setReadPos(). Negative positions are relative to
+// the end of the file.
+FileStatus DataFile::seekRead(int64_t pos) noexcept {
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // move pointer, fstream fails on positions before the beginning
+    std::streampos previous = data_file_->tellg();
+    if (pos < 0)
+        data_file_->seekg(pos, std::ios::end);
+    else
+        data_file_->seekg(pos + data_offset_, std::ios::beg);
+    if (data_file_->fail() || (pos < 0 && getReadPos() < 0)) {
+        // a negative pos can land inside the header, put the pointer back
+        data_file_->clear();
+        data_file_->seekg(previous);
+        return FileStatus::out_of_range;
+    }
+
+    return FileStatus::ok;
+}
+
+// Non-throwing version of setWritePos(). Negative positions are relative to
+// the end of the file.
+FileStatus DataFile::seekWrite(int64_t pos) noexcept {
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // move pointer, fstream fails on positions before the beginning
+    std::streampos previous = data_file_->tellp();
+    if (pos < 0)
+        data_file_->seekp(pos, std::ios::end);
+    else
+        data_file_->seekp(pos + data_offset_, std::ios::beg);
+    if (data_file_->fail() || (pos < 0 && getWritePos() < 0)) {
+        // a negative pos can land inside the header, put the pointer back
+        data_file_->clear();
+        data_file_->seekp(previous);
+        return FileStatus::out_of_range;
+    }
+
+    return FileStatus::ok;
+}
+
+// Handles a read that returned fewer than the requested bytes.
+//
+// At the end of the file, clears the eof/fail flags and moves the read pointer
+// back over the count bytes that were consumed, so the caller can retry or
+// continue from the same place. Anything else is reported as an io_error.
+FileStatus DataFile::undoShortRead(std::streamsize count) noexcept {
+    bool corrupt = checksumFailed();
+    if (data_file_->bad() || !data_file_->eof())
+        return FileStatus::io_error;
+
+    data_file_->clear();
+    data_file_->seekg(-static_cast<std::streamoff>(count), std::ios::cur);
+
+    return corrupt ? FileStatus::checksum_error : FileStatus::end_of_file;
+}
+
+// Returns true if a block failed its checksum since the last call. Reads stop
+// at a corrupt block as if it were the end of the file.
+bool DataFile::checksumFailed() noexcept {
+    return checksum_buffer_ && checksum_buffer_->takeFailure();
+}
+
+// Throws for a read that came up short: ChecksumError if it stopped at a
+// corrupt block, std::out_of_range otherwise.
+void DataFile::throwShortRead() {
+    if (checksumFailed()) {
+        data_file_->clear();
+        throw ChecksumError(checksum_buffer_->getBadBlock());
+    }
+
+    throw std::out_of_range("End of file reached.");
+}
+
+/***** LENGTH PREFIX FUNCTIONS *****/
+
+// Reads a string length prefix in the file's string encoding.
+uint64_t DataFile::readLength() {
+    if (string_encoding_ == StringEncoding::fixed16) {
+        uint16_t len;
+        read(&len);
+        return len;
+    }
 
-void DataFile::write(const std::string &str) {
-    // check string length
-    size_t str_len = str.length();
-    if (str_len > USHRT_MAX)
+    // check if file is open
+    if (!isOpen())
+        throw std::runtime_error("File is not open or could not be opened.");
+
+    // varint, from the stream buffer's window if it holds a whole prefix
+    uint64_t len = 0;
+    if (peekLength(&len))
+        return len;
+
+    // otherwise one byte at a time
+    for (int i = 0; i < Varint::max_length; ++i) {
+        int byte = data_file_->get();
+        if (byte == std::char_traits<char>::eof())
+            throwShortRead();
+
+        len |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if (byte < 0x80)
+            return len;
+    }
+
+    throw std::ios_base::failure("Invalid string length.");
+}
+
+// Decodes a varint length prefix with Varint::decode() when the stream buffer
+// already holds max_length bytes, giving back the bytes after the prefix.
+// Returns false, having read nothing, if fewer bytes are buffered or the
+// prefix is damaged; the byte loops in the callers then take over.
+bool DataFile::peekLength(uint64_t *len) noexcept {
+    std::streambuf *buffer = streamBuffer();
+    if (buffer->in_avail() < Varint::max_length)
+        return false;
+
+    unsigned char window[Varint::max_length];
+    std::streamsize count = buffer->sgetn(reinterpret_cast<char*>(window), Varint::max_length);
+    int used = Varint::decode(window, window + count, len);
+
+    // the bytes were just read from the buffer, so they can be put back
+    // without a seek unless the buffer does not keep them
+    std::streamsize unread = count - used;
+    while (unread > 0 && buffer->sungetc() != std::char_traits<char>::eof())
+        --unread;
+    if (unread > 0)
+        buffer->pubseekoff(-unread, std::ios::cur, std::ios::in);
+
+    return used > 0;
+}
+
+// Writes a string length prefix in the file's string encoding.
+//
+// Throws std::length_error if len does not fit in a fixed16 prefix.
+void DataFile::writeLength(uint64_t len) {
+    FileStatus status = tryWriteLength(len);
+    if (status == FileStatus::length_error)
         throw std::length_error("String length exceeds maximum limit.");
+    if (status == FileStatus::not_open)
+        throw std::runtime_error("File is not open or could not be opened.");
+}
 
+// Non-throwing version of readLength(). On end of file, the read position
+// is left before the prefix.
+FileStatus DataFile::tryReadLength(uint64_t *len) noexcept {
+    if (string_encoding_ == StringEncoding::fixed16) {
+        uint16_t fixed_len = 0;
+        FileStatus status = tryRead(&fixed_len);
+        *len = fixed_len;
+        return status;
+    }
+
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    if (peekLength(len))
+        return FileStatus::ok;
+
+    uint64_t value = 0;
+    for (int i = 0; i < Varint::max_length; ++i) {
+        int byte = data_file_->get();
+        if (byte == std::char_traits<char>::eof())
+            return undoShortRead(i);
+
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if (byte < 0x80) {
+            *len = value;
+            return FileStatus::ok;
+        }
+    }
+
+    return FileStatus::io_error;
+}
+
+// Non-throwing version of writeLength().
+FileStatus DataFile::tryWriteLength(uint64_t len) noexcept {
+    if (string_encoding_ == StringEncoding::fixed16) {
+        // check string length
+        if (len > USHRT_MAX)
+            return FileStatus::length_error;
+
+        uint16_t fixed_len = static_cast<uint16_t>(len);
+        return tryWrite(&fixed_len);
+    }
+
+    unsigned char prefix[Varint::max_length];
+    return tryWriteArray(prefix, Varint::encode(len, prefix));
+}
+
+// Returns true if the file holds at least count values of size bytes after
+// pos, or after the read position if pos is -1, so a damaged length prefix is
+// caught before anything is allocated for it. Up to a page of bytes is not
+// checked: allocating that much is harmless, and finding the file size costs
+// two seeks.
+bool DataFile::fitsInFile(uint64_t count, uint64_t size, int64_t pos) const {
+    if (count <= static_cast<uint64_t>(unchecked_length) / std::max<uint64_t>(size, 1))
+        return true;
+
+    int64_t file_size = getFileSize();
+    if (pos < 0)
+        pos = getReadPos();
+    if (file_size < 0 || pos < 0 || pos > file_size)
+        return false;
+    return count <= static_cast<uint64_t>(file_size - pos) / std::max<uint64_t>(size, 1);
+}
+
+// Returns the number of bytes a length prefix for len takes in this file.
+int64_t DataFile::lengthSize(uint64_t len) const { return lengthSize(len, string_encoding_); }
+
+// Returns the number of bytes a length prefix for len takes with encoding.
+int64_t DataFile::lengthSize(uint64_t len, StringEncoding encoding) {
+    if (encoding == StringEncoding::fixed16)
+        return sizeof(uint16_t);
+    return Varint::size(len);
+}
+
+/***** WRITE FUNCTIONS *****/
+
+void DataFile::write(const std::string &str) { writeString(str.data(), str.length()); }
+
+void DataFile::write(const std::string &str, int64_t pos) {
+    // move write pointer
+    setWritePos(pos);
+    // write to file
+    write(str);
+}
+
+void DataFile::write(const std::pmr::string &str) { writeString(str.data(), str.length()); }
+
+void DataFile::write(const std::pmr::string &str, int64_t pos) {
+    // move write pointer
+    setWritePos(pos);
+    // write to file
+    write(str);
+}
+
+// Shared by the std::string and std::pmr::string writes.
+void DataFile::writeString(const char *data, uint64_t len) {
     // write string length
-    uint16_t len = static_cast<uint16_t>(str_len);
-    write(&len);
+    writeLength(len);
     
     // Check for write errors after writing length
     if (data_file_->fail())
         throw std::ios_base::failure("Error occurred while writing to file.");
     
     // write string without null terminator
-    data_file_->write(str.c_str(), len);
+    data_file_->write(data, static_cast<std::streamsize>(len));
 
     // Check for write errors after writing string
     if (data_file_->fail())
         throw std::ios_base::failure("Error occurred while writing to file.");
 }
 
-void DataFile::write(const std::string &str, int64_t pos) {
-    // move write pointer
-    setWritePos(pos);
-    // write to file
-    write(str);
-}
-
 // returns true if file is empty, false otherwise
 bool DataFile::isEmpty() const { return getFileSize() == 0; }
 
+// Re-reads the whole file and returns the indexes of the blocks that do not
+// match their checksums, in order. An empty result means the file is intact.
+//
+// Blocks are read and checked on threads threads, each with its own file
+// handle. If threads is 0, one thread per hardware core is used.
+std::vector<int64_t> DataFile::verify(unsigned int threads) {
+    // check if file is open
+    if (!isOpen())
+        throw std::runtime_error("File is not open.");
+    if (!checksum_buffer_)
+        throw std::runtime_error("File does not have checksums.");
+
+    // store any compressed block still buffered above the checksums
+    data_file_->flush();
+    return checksum_buffer_->verify(file_path_ + file_name_, threads);
+}
+
+// Returns the root of the hash tree over the file's block checksums. Two
+// files with the same block size and the same root have the same contents,
+// so checking a whole file against a known root is one comparison.
+//
+// The tree is kept up to date as blocks are written; only blocks that have
+// no checksum yet are read.
+uint64_t DataFile::getRootHash() {
+    // check if file is open
+    if (!isOpen())
+        throw std::runtime_error("File is not open.");
+    if (!checksum_buffer_)
+        throw std::runtime_error("File does not have checksums.");
+
+    data_file_->flush();
+    return checksum_buffer_->getTree().getRoot();
+}
+
+// Returns the indexes of the blocks that differ between this file and other,
+// in order, by comparing their hash trees from the root down. Only subtrees
+// with different hashes are visited and neither file is read, so comparing
+// replicas costs O(k log n) for k changed blocks.
+//
+// Both files must be open with checksums of the same block size.
+std::vector<int64_t> DataFile::diffBlocks(DataFile &other) {
+    // check if files are open
+    if (!isOpen() || !other.isOpen())
+        throw std::runtime_error("File is not open.");
+    if (!checksum_buffer_ || !other.checksum_buffer_)
+        throw std::runtime_error("File does not have checksums.");
+    if (checksum_block_size_ != other.checksum_block_size_)
+        throw std::invalid_argument("Files have different checksum block sizes.");
+
+    data_file_->flush();
+    other.data_file_->flush();
+    return checksum_buffer_->getTree().diff(other.checksum_buffer_->getTree());
+}
+
+// Adds a key of the records written to the file to its Bloom filter. Does
+// nothing if the file has no filter.
+void DataFile::addKey(std::string_view key) {
+    if (bloom_filter_)
+        bloom_filter_->add(key);
+}
+
+// Returns false if key was never added to the file, from the Bloom filter in
+// memory. Returns true if it may have been, or if the file has no filter.
+bool DataFile::mayContainKey(std::string_view key) const {
+    return !bloom_filter_ || bloom_filter_->mayContain(key);
+}
+
 // Prints out a hex dump to the console from data_file_ from start to end
 // 
 // Reads entire range at once; may not be suitable for large ranges.
@@ -445,3 +1424,230 @@ void DataFile::hexDump() {
     hexDump(0, getFileSize());
 }
 
+/***** CURSOR FUNCTIONS *****/
+
+// Returns a cursor that starts at the current read position.
+DataFile::Cursor DataFile::cursor(int64_t capacity) {
+    return Cursor(*this, capacity);
+}
+
+DataFile::Cursor::Cursor(DataFile &file, int64_t capacity):
+    file_(&file),
+    buffer_(static_cast<size_t>(capacity > 0 ? capacity : default_cursor_capacity)),
+    next_(buffer_.data()),
+    end_(buffer_.data()),
+    buffer_pos_(file.getReadPos()),
+    swap_bytes_(file.swap_bytes_) {
+    // check if file is open
+    if (!file.isOpen())
+        throw std::runtime_error("File is not open.");
+}
+
+// Moving a vector keeps its storage, so next_ and end_ stay valid.
+DataFile::Cursor::Cursor(Cursor &&other) noexcept:
+    file_(other.file_),
+    buffer_(std::move(other.buffer_)),
+    next_(other.next_),
+    end_(other.end_),
+    buffer_pos_(other.buffer_pos_),
+    swap_bytes_(other.swap_bytes_) {
+    other.file_ = nullptr;
+}
+
+// Leaves the file's read position at the cursor's position.
+DataFile::Cursor::~Cursor() {
+    if (file_ != nullptr && file_->isOpen()) {
+        file_->data_file_->clear();
+        file_->data_file_->seekg(getPos() + file_->data_offset_);
+    }
+}
+
+// Makes sure at least size bytes can be read from the buffer, reading ahead
+// as far as the buffer allows.
+//
+// Throws std::out_of_range if the file has fewer than size bytes left.
+void DataFile::Cursor::reserve(int64_t size) {
+    FileStatus status = tryReserve(size);
+    if (status == FileStatus::end_of_file)
+        throw std::out_of_range("End of file reached.");
+    if (status == FileStatus::checksum_error)
+        throw ChecksumError(file_->checksum_buffer_->getBadBlock());
+    if (status != FileStatus::ok)
+        throw std::runtime_error("File is not open or could not be read.");
+}
+
+FileStatus DataFile::Cursor::tryReserve(int64_t size) {
+    int64_t remaining = end_ - next_;
+    if (remaining >= size)
+        return FileStatus::ok;
+
+    if (file_ == nullptr || !file_->isOpen())
+        return FileStatus::not_open;
+
+    // move unread bytes to the front of the buffer
+    int64_t offset = next_ - buffer_.data();
+    std::memmove(buffer_.data(), next_, static_cast<size_t>(remaining));
+    buffer_pos_ += offset;
+
+    // grow buffer if a single reserve is larger than the capacity
+    if (static_cast<size_t>(size) > buffer_.size())
+        buffer_.resize(static_cast<size_t>(size));
+
+    // fill the rest of the buffer
+    std::fstream &stream = *file_->data_file_;
+    stream.read(buffer_.data() + remaining, static_cast<std::streamsize>(buffer_.size() - remaining));
+    int64_t filled = remaining + stream.gcount();
+    if (stream.eof())
+        stream.clear();
+
+    next_ = buffer_.data();
+    end_ = buffer_.data() + filled;
+
+    if (stream.bad())
+        return FileStatus::io_error;
+    if (filled < size && file_->checksumFailed())
+        return FileStatus::checksum_error;
+    return filled >= size ? FileStatus::ok : FileStatus::end_of_file;
+}
+
+// Reads a string length prefix in the file's string encoding.
+uint64_t DataFile::Cursor::getLength() {
+    if (file_->string_encoding_ == StringEncoding::fixed16) {
+        reserve(sizeof(uint16_t));
+        return get<uint16_t>();
+    }
+
+    // read ahead far enough for the longest prefix, a short window
+    // near the end of the file is fine as long as the prefix fits
+    if (available() < Varint::max_length)
+        tryReserve(Varint::max_length);
+
+    uint64_t len;
+    int size = Varint::decode(reinterpret_cast<const unsigned char*>(next_),
+                              reinterpret_cast<const unsigned char*>(end_), &len);
+    if (size == 0)
+        throw std::out_of_range("End of file reached.");
+
+    next_ += size;
+    return len;
+}
+
+// Reads a length-prefixed string, reserving as needed.
+void DataFile::Cursor::get(std::string &str) {
+    uint64_t len = getLength();
+    if (!file_->fitsInFile(len, 1, getPos()))
+        throw std::out_of_range("End of file reached.");
+    reserve(len);
+    str.assign(next_, len);
+    next_ += len;
+}
+
+// Reads a length-prefixed string into str's memory resource.
+void DataFile::Cursor::get(std::pmr::string &str) {
+    uint64_t len = getLength();
+    if (!file_->fitsInFile(len, 1, getPos()))
+        throw std::out_of_range("End of file reached.");
+    reserve(len);
+    str.assign(next_, len);
+    next_ += len;
+}
+
+// Moves the file's read position to the cursor's position and drops
+// any data that was read ahead.
+void DataFile::Cursor::sync() {
+    if (file_ == nullptr || !file_->isOpen())
+        return;
+
+    buffer_pos_ = getPos();
+    next_ = buffer_.data();
+    end_ = buffer_.data();
+
+    file_->data_file_->clear();
+    file_->data_file_->seekg(buffer_pos_ + file_->data_offset_);
+}
+
+// Returns the file position of the next byte the cursor will read.
+int64_t DataFile::Cursor::getPos() const {
+    return buffer_pos_ + (next_ - buffer_.data());
+}
+
+/***** BULK OPEN *****/
+
+// Opens every regular file in directory whose name matches pattern ('*' and '?'
+// wildcards) using a pool of worker threads, so that the per-file open latency
+// of slow or network-backed volumes overlaps instead of adding up.
+//
+// Files are returned in file name order and opened by exactly the name they
+// are listed under. Files that fail to open, or a directory that cannot be
+// listed, are reported in errors instead of throwing. If threads is 0, one
+// thread per hardware core is used.
+DataFile::OpenAllResult DataFile::openAll(std::string directory, std::string pattern,
+                                          std::ios::openmode mode, unsigned int threads) {
+    // DataFile paths are concatenated with file names, so make sure the
+    // directory ends with a separator
+    if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+        directory += static_cast<char>(std::filesystem::path::preferred_separator);
+
+    // collect matching file names
+    OpenAllResult result;
+    std::vector<std::string> names;
+    std::error_code error;
+    std::filesystem::directory_iterator entries(directory, error);
+    for (; !error && entries != std::filesystem::directory_iterator(); entries.increment(error)) {
+        if (!entries->is_regular_file())
+            continue;
+        std::string name = entries->path().filename().string();
+        if (matchesPattern(name, pattern))
+            names.push_back(name);
+    }
+    if (error) {
+        result.errors.push_back({directory, error.message()});
+        return result;
+    }
+    std::sort(names.begin(), names.end());
+
+    // one slot per file so workers never contend on the result containers
+    std::vector<std::unique_ptr<DataFile>> opened(names.size());
+    std::vector<std::string> messages(names.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < names.size(); i = next++) {
+            try {
+                // a listed name without an extension keeps none, and a file
+                // that cannot be opened is not created in its place
+                auto file = std::make_unique<DataFile>();
+                file->setFilePath(directory);
+                file->setFileName(names[i]);
+                if (names[i].find_last_of('.') == std::string::npos)
+                    file->setFileExtension("");
+                file->openFile(mode, false);
+                opened[i] = std::move(file);
+            } catch (const std::exception &e) {
+                messages[i] = e.what();
+            }
+        }
+    };
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, names.size()));
+
+    std::vector<std::thread> pool;
+    for (unsigned int i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &thread : pool)
+        thread.join();
+
+    // gather results in file name order
+    result.files.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (opened[i])
+            result.files.push_back(std::move(opened[i]));
+        else
+            result.errors.push_back({names[i], messages[i]});
+    }
+
+    return result;
+}
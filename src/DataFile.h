@@ -12,11 +12,27 @@
 #ifndef DATA_FILE_H
 #define DATA_FILE_H
 
+#include <array>
+#include <cassert>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
+#include "BitPack.h"
+#include "BloomFilter.h"
+#include "ByteSwap.h"
+#include "ChecksumBuffer.h"
+#include "CompressedBuffer.h"
+#include "FloatSeries.h"
+#include "StreamVByte.h"
+#include "StringArena.h"
+
 
 /**
  * @brief A set of constants for the open modes used.
@@ -39,13 +55,125 @@ namespace OpenMode {
     static const std::ios::openmode overwrite = std::ios::binary | std::ios::out;
 }
 
+/**
+ * @brief Result codes returned by the non-throwing tryRead/tryWrite functions.
+ * 
+ * - ok           = the operation completed
+ * 
+ * - not_open     = the file is not open
+ * 
+ * - end_of_file  = not enough data left; the read position is left unchanged
+ * 
+ * - out_of_range = the requested position is before the beginning of the file
+ * 
+ * - length_error = the string is too long to be written
+ * 
+ * - io_error     = the underlying fstream failed; its error flags are left set
+ * 
+ * - checksum_error = a block failed its checksum; the read position is left unchanged
+ * 
+ */
+enum class FileStatus {
+    ok,
+    not_open,
+    end_of_file,
+    out_of_range,
+    length_error,
+    io_error,
+    checksum_error
+};
+
+/**
+ * @brief Encodings for the length prefix written before each string.
+ * 
+ * - fixed16 = 2-byte uint16_t length, strings are limited to 65535 bytes
+ * 
+ * - varint  = LEB128 varint length, 1 byte below 128 and up to 10 bytes
+ *             for 64-bit lengths
+ * 
+ */
+enum class StringEncoding {
+    fixed16,
+    varint
+};
+
+/**
+ * @brief Byte order of the numbers stored in a file.
+ * 
+ * - native = whatever the host uses, no conversion
+ * 
+ * - little = little-endian, converted on big-endian hosts
+ * 
+ * - big    = big-endian, converted on little-endian hosts
+ * 
+ * Only 2, 4 and 8 byte integers, floating point numbers and enums are
+ * converted, including arrays and containers of them. Structs are copied
+ * as they are.
+ * 
+ */
+enum class ByteOrder {
+    native,
+    little,
+    big
+};
+
+/**
+ * @brief Flags stored in a FileHeader, describing how the file was written.
+ * 
+ * - big_endian     = numbers are big-endian, otherwise little-endian
+ * 
+ * - varint_strings = string and container lengths use StringEncoding::varint
+ * 
+ * - compressed     = the file body is block compressed
+ * 
+ */
+namespace HeaderFlags {
+    static const uint16_t big_endian = 0x0001;
+    static const uint16_t varint_strings = 0x0002;
+    static const uint16_t compressed = 0x0004;
+}
+
+/**
+ * @brief An optional header at the start of a file, so that the wrong kind of
+ *        file is rejected at open instead of halfway through a scan.
+ * 
+ * The header is FileHeader::size bytes and is always stored little-endian:
+ * 
+ * - 0  uint32_t magic           caller chosen file type id
+ * 
+ * - 4  uint16_t header size     FileHeader::size
+ * 
+ * - 6  uint16_t flags           HeaderFlags, filled in by DataFile
+ * 
+ * - 8  uint32_t format version  caller's file format version
+ * 
+ * - 12 uint32_t reserved
+ * 
+ * - 16 uint64_t schema hash     caller's record layout hash, e.g. RecordFields::schema_hash
+ * 
+ * - 24 uint64_t reserved
+ * 
+ */
+struct FileHeader {
+    uint32_t                        magic = 0;
+    uint32_t                        format_version = 0;
+    uint64_t                        schema_hash = 0;
+    uint16_t                        flags = 0;
+
+    static constexpr int64_t        size = 32;
+};
+
 class DataFile {
 public:
     DataFile();
     DataFile(std::string file_name, std::ios::openmode mode = OpenMode::edit);
     DataFile(std::string file_name, std::string file_path, std::ios::openmode mode = OpenMode::edit);
+    DataFile(DataFile &&other) noexcept;
     ~DataFile();
 
+    DataFile                       &operator=(DataFile &&other) noexcept;
+    void                            swap(DataFile &other) noexcept;
+
     // open/close functions
 
     void                            open(std::ios::openmode mode = OpenMode::edit);
@@ -60,6 +188,16 @@ public:
     std::string                     getFilePath() const;
     int64_t                         getFileSize() const;
     std::ios_base::openmode         getOpenMode() const;
+    StringEncoding                  getStringEncoding() const;
+    ByteOrder                       getByteOrder() const;
+    const FileHeader               &getHeader() const;
+    bool                            hasHeader() const;
+    bool                            hasChecksums() const;
+    int64_t                         getChecksumBlockSize() const;
+    bool                            isCompressed() const;
+    int64_t                         getCompressionBlockSize() const;
+    bool                            hasBloomFilter() const;
+    bool                            needsByteSwap() const;
     int64_t                         getReadPos() const;
     int64_t                         getWritePos() const;
 
@@ -68,6 +206,18 @@ public:
     void                            setFileName(std::string file_name);
     void                            setFileExtension(std::string extension);
     void                            setFilePath(std::string file_path);
+    void                            setStringEncoding(StringEncoding encoding);
+    void                            setByteOrder(ByteOrder order);
+    void                            setHeader(const FileHeader &header);
+    void                            clearHeader();
+    void                            enableChecksums(int64_t block_size = default_checksum_block_size);
+    void                            disableChecksums();
+    void                            enableCompression(int64_t block_size = default_compression_block_size,
+                                                      unsigned int threads = 0);
+    void                            disableCompression();
+    void                            enableBloomFilter(int64_t expected_keys = default_bloom_expected_keys,
+                                                      int bits_per_key = BloomFilter::default_bits_per_key);
+    void                            disableBloomFilter();
     void                            setReadPos(int64_t pos);
     void                            setReadPosBegin();
     void                            setReadPosEnd();
@@ -90,8 +240,33 @@ public:
     template<typename T> void       read(T *data, int64_t pos);
     template<typename T> void       readArray(T *data, int64_t len);
     template<typename T> void       readArray(T *data, int64_t len, int64_t pos);
+    template<typename T> void       readPackedArray(T *data, int64_t len);
+    template<typename T> void       readPackedArray(T *data, int64_t len, int64_t pos);
+    template<typename T> void       readFloatSeries(T *data, int64_t len);
+    template<typename T> void       readFloatSeries(T *data, int64_t len, int64_t pos);
+    template<typename T> void       readVarintArray(T *data, int64_t len);
+    template<typename T> void       readVarintArray(T *data, int64_t len, int64_t pos);
     void                            read(std::string &str);
     void                            read(std::string &str, int64_t pos);
+    void                            read(std::pmr::string &str);
+    void                            read(std::pmr::string &str, int64_t pos);
+    void                            read(std::string_view &str, std::pmr::memory_resource &arena);
+    void                            read(std::string_view &str, std::pmr::memory_resource &arena, int64_t pos);
+
+    // container read functions
+
+    template<typename T, typename A> void               read(std::vector<T, A> &vec);
+    template<typename T, size_t N> void                 read(std::array<T, N> &arr);
+    template<typename K, typename V, typename C, typename A> void read(std::map<K, V, C, A> &map);
+
+    // non-throwing read functions
+
+    template<typename T> FileStatus tryRead(T *data) noexcept;
+    template<typename T> FileStatus tryRead(T *data, int64_t pos) noexcept;
+    template<typename T> FileStatus tryReadArray(T *data, int64_t len) noexcept;
+    template<typename T> FileStatus tryReadArray(T *data, int64_t len, int64_t pos) noexcept;
+    FileStatus                      tryRead(std::string &str) noexcept;
+    FileStatus                      tryRead(std::string &str, int64_t pos) noexcept;
 
     // write functions
 
@@ -99,22 +274,105 @@ public:
     template<typename T> void       write(const T *data, int64_t pos);
     template<typename T> void       writeArray(const T *data, int64_t len);
     template<typename T> void       writeArray(const T *data, int64_t len, int64_t pos);
+    template<typename T> void       writePackedArray(const T *data, int64_t len, IntEncoding encoding = IntEncoding::delta);
+    template<typename T> void       writePackedArray(const T *data, int64_t len, IntEncoding encoding, int64_t pos);
+    template<typename T> void       writeFloatSeries(const T *data, int64_t len);
+    template<typename T> void       writeFloatSeries(const T *data, int64_t len, int64_t pos);
+    template<typename T> void       writeVarintArray(const T *data, int64_t len);
+    template<typename T> void       writeVarintArray(const T *data, int64_t len, int64_t pos);
     void                            write(const std::string &str);
     void                            write(const std::string &str, int64_t pos);
+    void                            write(const std::pmr::string &str);
+    void                            write(const std::pmr::string &str, int64_t pos);
+
+    // container write functions
+
+    template<typename T, typename A> void               write(const std::vector<T, A> &vec);
+    template<typename T, size_t N> void                 write(const std::array<T, N> &arr);
+    template<typename K, typename V, typename C, typename A> void write(const std::map<K, V, C, A> &map);
+
+    // non-throwing write functions
+
+    template<typename T> FileStatus tryWrite(const T *data) noexcept;
+    template<typename T> FileStatus tryWrite(const T *data, int64_t pos) noexcept;
+    template<typename T> FileStatus tryWriteArray(const T *data, int64_t len) noexcept;
+    template<typename T> FileStatus tryWriteArray(const T *data, int64_t len, int64_t pos) noexcept;
+    FileStatus                      tryWrite(const std::string &str) noexcept;
+    FileStatus                      tryWrite(const std::string &str, int64_t pos) noexcept;
 
     // utility functions
 
     bool                            isEmpty() const;
+    std::vector<int64_t>            verify(unsigned int threads = 0);
+    uint64_t                        getRootHash();
+    std::vector<int64_t>            diffBlocks(DataFile &other);
+    void                            addKey(std::string_view key);
+    bool                            mayContainKey(std::string_view key) const;
     void                            hexDump(int64_t start, int64_t size);
     void                            hexDump();
+    static int64_t                  lengthSize(uint64_t len, StringEncoding encoding);
+
+    // bulk open
+
+    struct OpenError {
+        std::string                 file_name;
+        std::string                 message;
+    };
+    struct OpenAllResult {
+        std::vector<std::unique_ptr<DataFile>>  files;
+        std::vector<OpenError>                  errors;
+    };
+    static OpenAllResult            openAll(std::string directory, std::string pattern = "*",
+                                            std::ios::openmode mode = OpenMode::readonly,
+                                            unsigned int threads = 0);
+
+    // bulk read cursor
+
+    class Cursor;
+    Cursor                          cursor(int64_t capacity = default_cursor_capacity);
 
     // static constants
 
     static const std::string        default_file_extension;
     static const std::string        default_file_path;
     static const char               hex_values_[16];
+    static constexpr int64_t        default_cursor_capacity = 4096;
+    static constexpr int64_t        default_checksum_block_size = 64 * 1024;
+    static constexpr int64_t        default_compression_block_size = 64 * 1024;
+    static constexpr int64_t        default_bloom_expected_keys = 64 * 1024;
+    static constexpr int64_t        unchecked_length = 4096;
 
 private:
+    // helper functions
+
+    template<typename T> static constexpr bool isScalarSize();
+    std::streambuf                 *streamBuffer() const;
+    template<typename T> bool       readScalar(T *data);
+    template<typename T> bool       writeScalar(const T *data);
+    template<typename T> void       fromFileOrder(T *data, int64_t len) const;
+    template<typename T> bool       writeSwapped(const T *data, int64_t len);
+    void                            openFile(std::ios::openmode mode, bool create);
+    void                            openHeader();
+    void                            openChecksums();
+    void                            openCompression();
+    void                            openBloomFilter();
+    bool                            checksumFailed() noexcept;
+    void                            throwShortRead();
+    template<typename S> void       readString(S &str);
+    template<typename T> void       readValue(T &value);
+    template<typename T> void       writeValue(const T &value);
+    void                            writeString(const char *data, uint64_t len);
+    uint64_t                        readLength();
+    void                            writeLength(uint64_t len);
+    FileStatus                      tryReadLength(uint64_t *len) noexcept;
+    bool                            peekLength(uint64_t *len) noexcept;
+    FileStatus                      tryWriteLength(uint64_t len) noexcept;
+    int64_t                         lengthSize(uint64_t len) const;
+    bool                            fitsInFile(uint64_t count, uint64_t size = 1, int64_t pos = -1) const;
+    FileStatus                      seekRead(int64_t pos) noexcept;
+    FileStatus                      seekWrite(int64_t pos) noexcept;
+    FileStatus                      undoShortRead(std::streamsize count) noexcept;
+
     // member variables
 
     std::unique_ptr<std::fstream>   data_file_;
@@ -122,24 +380,209 @@ private:
     std::string                     file_extension_;
     std::string                     file_path_;
     std::ios_base::openmode         ios_openmode_;
+    StringEncoding                  string_encoding_;
+    ByteOrder                       byte_order_;
+    bool                            swap_bytes_;        // true if byte_order_ is not the host's
+    FileHeader                      header_;
+    bool                            has_header_;
+    int64_t                         data_offset_;       // physical position of logical position 0
+    int64_t                         checksum_block_size_; // 0 if checksums are off
+    std::unique_ptr<ChecksumBuffer> checksum_buffer_;   // the fstream's buffer while open, if checksummed
+    int64_t                         compression_block_size_; // 0 if compression is off
+    bool                            header_compressed_; // this open only: the header says compressed
+    unsigned int                    compression_threads_;
+    std::unique_ptr<CompressedBuffer> compressed_buffer_; // above checksum_buffer_, if compressed
+    int                             bloom_bits_per_key_; // 0 if the Bloom filter is off
+    int64_t                         bloom_expected_keys_;
+    std::unique_ptr<BloomFilter>    bloom_filter_;      // kept after close for lookups
+
+};
+
+void                                swap(DataFile &lhs, DataFile &rhs) noexcept;
+
+/**
+ * @brief A read-ahead cursor over a DataFile for decoding many small fields.
+ * 
+ * reserve(size) checks the file once and prefetches at least size bytes into
+ * the cursor's buffer. The get functions then copy straight out of the buffer
+ * without any open or bounds checks, so the caller must not get more than was
+ * reserved. Debug builds assert on overruns.
+ * 
+ * The cursor reads ahead of its own position. The file's read position is moved
+ * back to the cursor's position by sync() and when the cursor is destroyed.
+ * 
+ */
+class DataFile::Cursor {
+public:
+    explicit Cursor(DataFile &file, int64_t capacity = default_cursor_capacity);
+    Cursor(Cursor &&other) noexcept;
+    ~Cursor();
+
+    Cursor(const Cursor &) = delete;
+    Cursor                         &operator=(const Cursor &) = delete;
+
+    // checked functions
+
+    void                            reserve(int64_t size);
+    FileStatus                      tryReserve(int64_t size);
+    void                            get(std::string &str);
+    void                            get(std::pmr::string &str);
+    void                            sync();
+
+    // unchecked functions
+
+    template<typename T> T          get();
+    template<typename T> void       get(T *data);
+    template<typename T> void       getArray(T *data, int64_t len);
+    void                            skip(int64_t size);
+    const char                     *data() const;
+
+    // getters/accessors
+
+    int64_t                         available() const;
+    int64_t                         getPos() const;
+
+private:
+    // helper functions
+
+    uint64_t                        getLength();
+
+    // member variables
+
+    DataFile                       *file_;
+    std::vector<char>               buffer_;
+    const char                     *next_;          // next unread byte in buffer_
+    const char                     *end_;           // end of valid data in buffer_
+    int64_t                         buffer_pos_;    // file position of buffer_[0]
+    bool                            swap_bytes_;    // file's byte order when the cursor was made
 
 };
 
+/***** TEMPLATED SCALAR HELPERS *****/
+
+// The templated read and write functions copy raw bytes, so they only accept
+// trivially copyable types. 1, 2, 4, 8 and 16 byte types skip the istream and
+// its separate bounds check and go straight to the stream buffer: a single
+// byte is an inline sbumpc()/sputc(), and the other sizes are one sgetn()/sputn()
+// into local storage followed by a fixed-size memcpy, which compiles to a single
+// load and store. The end of the file is detected from the short read.
+
+template<typename T>
+constexpr bool DataFile::isScalarSize() {
+    return sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8 || sizeof(T) == 16;
+}
+
+// Returns the buffer the stream reads and writes through.
+inline std::streambuf *DataFile::streamBuffer() const {
+    return static_cast<std::ios&>(*data_file_).rdbuf();
+}
+
+// Reads one scalar from the stream buffer. Returns false and leaves data and
+// the read position unchanged if there are not enough bytes left, setting
+// eofbit and failbit as a short fstream read would. gcount() is not updated.
+template<typename T>
+bool DataFile::readScalar(T *data) {
+    std::streambuf *buffer = streamBuffer();
+
+    if constexpr (sizeof(T) == 1) {
+        int byte = buffer->sbumpc();
+        if (byte == std::char_traits<char>::eof()) {
+            data_file_->setstate(std::ios::eofbit | std::ios::failbit);
+            return false;
+        }
+        unsigned char value = static_cast<unsigned char>(byte);
+        std::memcpy(data, &value, 1);
+    } else {
+        alignas(T) char bytes[sizeof(T)];
+        std::streamsize count = buffer->sgetn(bytes, sizeof(T));
+        if (count != static_cast<std::streamsize>(sizeof(T))) {
+            buffer->pubseekoff(-count, std::ios::cur, std::ios::in);
+            data_file_->setstate(std::ios::eofbit | std::ios::failbit);
+            return false;
+        }
+        std::memcpy(data, bytes, sizeof(T));
+    }
+
+    return true;
+}
+
+// Writes one scalar to the stream buffer. Returns false on a write error.
+template<typename T>
+bool DataFile::writeScalar(const T *data) {
+    std::streambuf *buffer = streamBuffer();
+
+    if constexpr (sizeof(T) == 1) {
+        unsigned char value;
+        std::memcpy(&value, data, 1);
+        return buffer->sputc(static_cast<char>(value)) != std::char_traits<char>::eof();
+    } else {
+        alignas(T) char bytes[sizeof(T)];
+        std::memcpy(bytes, data, sizeof(T));
+        return buffer->sputn(bytes, sizeof(T)) == static_cast<std::streamsize>(sizeof(T));
+    }
+}
+
+
+// Converts len values that were just read from file byte order to host
+// byte order. Does nothing for native files and non-swappable types.
+template<typename T>
+void DataFile::fromFileOrder(T *data, int64_t len) const {
+    if constexpr (ByteSwap::is_swappable<T>) {
+        if (swap_bytes_) {
+            if (len == 1)
+                *data = ByteSwap::swap(*data);
+            else
+                ByteSwap::swapArray(data, len);
+        }
+    }
+}
+
+// Writes len values in file byte order, swapping them through a small
+// buffer so data is left untouched. Returns false on a write error.
+template<typename T>
+bool DataFile::writeSwapped(const T *data, int64_t len) {
+    constexpr int64_t chunk_len = 4096 / sizeof(T);
+    T chunk[chunk_len];
+
+    for (int64_t done = 0; done < len; done += chunk_len) {
+        int64_t count = (len - done < chunk_len) ? len - done : chunk_len;
+        std::memcpy(chunk, data + done, count * sizeof(T));
+        ByteSwap::swapArray(chunk, count);
+        data_file_->write(reinterpret_cast<const char*>(chunk), count * sizeof(T));
+    }
+
+    return !data_file_->fail();
+}
+
+
+
 /***** TEMPLATED READ FUNCTIONS *****/
 
 template<typename T>
 void DataFile::read(T *data) {
+    static_assert(std::is_trivially_copyable_v<T>, "read() can only copy trivially copyable types.");
+
     // check if file is open
     if (!isOpen())
         throw std::runtime_error("File is not open or could not be opened.");
 
+    // read scalars straight from the stream buffer
+    if constexpr (isScalarSize<T>()) {
+        if (!readScalar(data))
+            throwShortRead();
+        fromFileOrder(data, 1);
+        return;
+    }
+
     // check if read will go out of bounds
-    std::streampos current_pos = data_file_->tellg();
-    if (current_pos + static_cast<std::streamoff>(sizeof(T)) > getFileSize())
+    if (getReadPos() + static_cast<int64_t>(sizeof(T)) > getFileSize())
         throw std::out_of_range("End of file reached.");
     
     // read from file
     data_file_->read(reinterpret_cast<char*>(data), sizeof(T));
+    if (data_file_->gcount() != static_cast<std::streamsize>(sizeof(T)))
+        throwShortRead();
+    fromFileOrder(data, 1);
 }
 
 template<typename T>
@@ -152,17 +595,21 @@ void DataFile::read(T *data, int64_t pos) {
 
 template<typename T>
 void DataFile::readArray(T *data, int64_t len) {
+    static_assert(std::is_trivially_copyable_v<T>, "readArray() can only copy trivially copyable types.");
+
     // check if file is open
     if (!isOpen())
         throw std::runtime_error("File is not open or could not be opened.");
 
     // check if read will go out of bounds
-    std::streampos current_pos = data_file_->tellg();
-    if (current_pos + static_cast<std::streamoff>(len * sizeof(T)) > static_cast<std::streamoff>(getFileSize()))
+    if (getReadPos() + static_cast<int64_t>(len * sizeof(T)) > getFileSize())
         throw std::out_of_range("End of file reached.");
     
     // read from file    
     data_file_->read(reinterpret_cast<char*>(data), len * sizeof(T));
+    if (data_file_->gcount() != static_cast<std::streamsize>(len * sizeof(T)))
+        throwShortRead();
+    fromFileOrder(data, len);
 }
 
 template<typename T>
@@ -173,16 +620,120 @@ void DataFile::readArray(T *data, int64_t len, int64_t pos) {
     readArray(data, len);
 }
 
+// Reads len integers written by writePackedArray.
+//
+// Throws std::runtime_error if the packed bytes are damaged or hold a
+// different number of values.
+template<typename T>
+void DataFile::readPackedArray(T *data, int64_t len) {
+    static_assert(BitPackDetail::is_packable<T>, "readPackedArray() can only read integers.");
+
+    // read packed size
+    int64_t size;
+    read(&size);
+    if (size < 1 || size > BitPack::maxPackedSize<T>(len))
+        throw std::runtime_error("Packed array is damaged.");
+
+    // read and unpack
+    std::vector<unsigned char> packed(static_cast<size_t>(size));
+    readArray(packed.data(), size);
+    if (!BitPack::decode(packed.data(), size, data, len))
+        throw std::runtime_error("Packed array is damaged.");
+}
+
+template<typename T>
+void DataFile::readPackedArray(T *data, int64_t len, int64_t pos) {
+    // move read pointer
+    setReadPos(pos);
+    // read from file
+    readPackedArray(data, len);
+}
+
+// Reads len floats or doubles written by writeFloatSeries.
+//
+// Throws std::runtime_error if the encoded bytes are damaged or hold a
+// different number of values.
+template<typename T>
+void DataFile::readFloatSeries(T *data, int64_t len) {
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>,
+                  "readFloatSeries() can only read float and double.");
+
+    // read encoded size
+    int64_t size;
+    read(&size);
+    if (size < 0 || size > FloatSeries::maxEncodedSize(len, 8 * sizeof(T)))
+        throw std::runtime_error("Float series is damaged.");
+
+    // read and decode
+    std::vector<unsigned char> encoded(static_cast<size_t>(size));
+    readArray(encoded.data(), size);
+    if (!FloatSeries::decode(encoded.data(), size, data, len))
+        throw std::runtime_error("Float series is damaged.");
+}
+
+template<typename T>
+void DataFile::readFloatSeries(T *data, int64_t len, int64_t pos) {
+    // move read pointer
+    setReadPos(pos);
+    // read from file
+    readFloatSeries(data, len);
+}
+
+// Reads len integers written by writeVarintArray.
+//
+// Throws std::runtime_error if the encoded bytes are damaged or hold a
+// different number of values.
+template<typename T>
+void DataFile::readVarintArray(T *data, int64_t len) {
+    static_assert(StreamVByteDetail::is_encodable<T>, "readVarintArray() can only read integers of up to 32 bits.");
+
+    // read encoded size
+    int64_t size;
+    read(&size);
+    if (size < StreamVByte::controlSize(len) || size > StreamVByte::controlSize(len) + StreamVByte::maxDataSize(len))
+        throw std::runtime_error("Varint array is damaged.");
+
+    // read and decode, leaving room for the decoder's wide loads
+    std::vector<unsigned char> encoded(static_cast<size_t>(size + StreamVByte::padding));
+    readArray(encoded.data(), size);
+    if (!StreamVByte::decode(encoded.data(), size, data, len))
+        throw std::runtime_error("Varint array is damaged.");
+}
+
+template<typename T>
+void DataFile::readVarintArray(T *data, int64_t len, int64_t pos) {
+    // move read pointer
+    setReadPos(pos);
+    // read from file
+    readVarintArray(data, len);
+}
+
 
 
 /***** TEMPLATED WRITE FUNCTIONS *****/
 
 template<typename T>
 void DataFile::write(const T *data) {
+    static_assert(std::is_trivially_copyable_v<T>, "write() can only copy trivially copyable types.");
+
     // check if file is open
     if (!isOpen())
         throw std::runtime_error("File is not open or could not be opened.");
 
+    // write scalars straight to the stream buffer
+    if constexpr (isScalarSize<T>()) {
+        T value = *data;
+        if constexpr (ByteSwap::is_swappable<T>) {
+            if (swap_bytes_)
+                value = ByteSwap::swap(value);
+        }
+        if (!writeScalar(&value)) {
+            data_file_->setstate(std::ios::badbit);
+            throw std::ios_base::failure("Error occurred while writing to file.");
+        }
+        return;
+    }
+
     // write to file
     data_file_->write(reinterpret_cast<const char*>(data), sizeof(T));
 
@@ -202,10 +753,20 @@ void DataFile::write(const T *data, int64_t pos) {
 
 template<typename T>
 void DataFile::writeArray(const T *data, int64_t len) {
+    static_assert(std::is_trivially_copyable_v<T>, "writeArray() can only copy trivially copyable types.");
+
     // check if file is open
     if (!isOpen())
         throw std::runtime_error("File is not open or could not be opened.");
 
+    // write in file byte order
+    if constexpr (ByteSwap::is_swappable<T>) {
+        if (swap_bytes_) {
+            writeSwapped(data, len);
+            return;
+        }
+    }
+
     // write to file
     data_file_->write(reinterpret_cast<const char*>(data), len * sizeof(T));
 }
@@ -218,9 +779,411 @@ void DataFile::writeArray(const T *data, int64_t len, int64_t pos) {
     writeArray(data, len);
 }
 
+// Writes len integers as an int64_t byte count followed by the
+// BitPack format, which packs each block of 128 values into as few bits as
+// its largest delta or offset needs. Small-range and sorted arrays take a
+// fraction of writeArray's size. The element count is not stored; read the
+// values back with readPackedArray and the same len.
+template<typename T>
+void DataFile::writePackedArray(const T *data, int64_t len, IntEncoding encoding) {
+    static_assert(BitPackDetail::is_packable<T>, "writePackedArray() can only write integers.");
 
-#endif
+    std::vector<unsigned char> packed;
+    BitPack::encode(data, len, encoding, packed);
+
+    // write packed size and bytes
+    int64_t size = static_cast<int64_t>(packed.size());
+    write(&size);
+    writeArray(packed.data(), size);
+}
+
+template<typename T>
+void DataFile::writePackedArray(const T *data, int64_t len, IntEncoding encoding, int64_t pos) {
+    // move write pointer
+    setWritePos(pos);
+    // write to file
+    writePackedArray(data, len, encoding);
+}
+
+// Writes len floats or doubles as an int64_t byte count followed by the
+// FloatSeries XOR encoding, which stores each value as the bits that changed
+// since the previous one. Series of correlated readings take a fraction of
+// writeArray's size. The element count is not stored; read the values back
+// with readFloatSeries and the same len.
+template<typename T>
+void DataFile::writeFloatSeries(const T *data, int64_t len) {
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>,
+                  "writeFloatSeries() can only write float and double.");
+
+    std::vector<unsigned char> encoded;
+    encoded.reserve(static_cast<size_t>(len * sizeof(T) / 4 + 16));
+    FloatSeries::encode(data, len, encoded);
+
+    // write encoded size and bytes
+    int64_t size = static_cast<int64_t>(encoded.size());
+    write(&size);
+    writeArray(encoded.data(), size);
+}
+
+template<typename T>
+void DataFile::writeFloatSeries(const T *data, int64_t len, int64_t pos) {
+    // move write pointer
+    setWritePos(pos);
+    // write to file
+    writeFloatSeries(data, len);
+}
+
+// Writes len integers as an int64_t byte count followed by the StreamVByte
+// format, which stores each value in 1 to 4 bytes with the lengths packed
+// into separate control bytes. Values below 256 (or between -128 and 127)
+// take a byte and a quarter, and decoding needs no per-byte loop. The element
+// count is not stored; read the values back with readVarintArray and the
+// same len.
+template<typename T>
+void DataFile::writeVarintArray(const T *data, int64_t len) {
+    static_assert(StreamVByteDetail::is_encodable<T>, "writeVarintArray() can only write integers of up to 32 bits.");
+
+    std::vector<unsigned char> encoded;
+    StreamVByte::encode(data, len, encoded);
+
+    // write encoded size and bytes
+    int64_t size = static_cast<int64_t>(encoded.size());
+    write(&size);
+    writeArray(encoded.data(), size);
+}
+
+template<typename T>
+void DataFile::writeVarintArray(const T *data, int64_t len, int64_t pos) {
+    // move write pointer
+    setWritePos(pos);
+    // write to file
+    writeVarintArray(data, len);
+}
+
+
+
+
+
+/***** TEMPLATED CONTAINER FUNCTIONS *****/
+
+// Containers are written as a length prefix, in the file's string encoding,
+// followed by their elements. std::array has a fixed size and is written
+// without a prefix. Vectors and arrays of trivially copyable types are read and
+// written with a single readArray/writeArray call. Other element types are read
+// one at a time into storage reserved up front, so nested strings and
+// containers work and the container never reallocates while it is filled.
+
+// Reads or writes one element: trivially copyable types as raw bytes,
+// everything else through its own read/write overload.
+template<typename T>
+void DataFile::readValue(T &value) {
+    if constexpr (std::is_trivially_copyable_v<T>)
+        read(&value);
+    else
+        read(value);
+}
 
+template<typename T>
+void DataFile::writeValue(const T &value) {
+    if constexpr (std::is_trivially_copyable_v<T>)
+        write(&value);
+    else
+        write(value);
+}
+
+template<typename T, typename A>
+void DataFile::read(std::vector<T, A> &vec) {
+    // read element count, making sure the file holds that many elements;
+    // every element takes at least one byte
+    uint64_t len = readLength();
+    constexpr bool read_at_once = std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool>;
+    if (!fitsInFile(len, read_at_once ? sizeof(T) : 1))
+        throwShortRead();
+
+    if constexpr (read_at_once) {
+        // read all elements at once
+        vec.resize(len);
+        readArray(vec.data(), static_cast<int64_t>(len));
+    } else {
+        // read elements in place
+        vec.clear();
+        vec.reserve(len);
+        for (uint64_t i = 0; i < len; ++i) {
+            if constexpr (std::is_same_v<T, bool>) {
+                // a damaged byte must not be loaded as a bool
+                uint8_t value;
+                read(&value);
+                vec.push_back(value != 0);
+            } else {
+                vec.emplace_back();
+                readValue(vec.back());
+            }
+        }
+    }
+}
+
+template<typename T, size_t N>
+void DataFile::read(std::array<T, N> &arr) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        readArray(arr.data(), static_cast<int64_t>(N));
+    } else {
+        for (T &value : arr)
+            readValue(value);
+    }
+}
+
+// Keys are written in order, so each element is inserted at the end
+// in constant time.
+template<typename K, typename V, typename C, typename A>
+void DataFile::read(std::map<K, V, C, A> &map) {
+    // read element count
+    uint64_t len = readLength();
+
+    map.clear();
+    for (uint64_t i = 0; i < len; ++i) {
+        K key;
+        V value;
+        readValue(key);
+        readValue(value);
+        map.emplace_hint(map.end(), std::move(key), std::move(value));
+    }
+}
+
+template<typename T, typename A>
+void DataFile::write(const std::vector<T, A> &vec) {
+    // write element count
+    writeLength(vec.size());
+
+    if constexpr (std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool>) {
+        // write all elements at once
+        writeArray(vec.data(), static_cast<int64_t>(vec.size()));
+    } else {
+        for (const auto &value : vec)
+            writeValue(static_cast<const T&>(value));
+    }
+}
+
+template<typename T, size_t N>
+void DataFile::write(const std::array<T, N> &arr) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        writeArray(arr.data(), static_cast<int64_t>(N));
+    } else {
+        for (const T &value : arr)
+            writeValue(value);
+    }
+}
+
+template<typename K, typename V, typename C, typename A>
+void DataFile::write(const std::map<K, V, C, A> &map) {
+    // write element count
+    writeLength(map.size());
+
+    for (const auto &[key, value] : map) {
+        writeValue(key);
+        writeValue(value);
+    }
+}
+
+
+
+/***** TEMPLATED NON-THROWING READ FUNCTIONS *****/
+
+// Reads without checking the file size first: a short read is detected from
+// gcount() afterwards, so the in-bounds case costs one fstream read and one
+// compare. On failure, the contents of data are unspecified.
+
+template<typename T>
+FileStatus DataFile::tryRead(T *data) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>, "tryRead() can only copy trivially copyable types.");
+
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // read scalars straight from the stream buffer
+    if constexpr (isScalarSize<T>()) {
+        if (!readScalar(data))
+            return undoShortRead(0);
+        fromFileOrder(data, 1);
+        return FileStatus::ok;
+    }
+
+    // read from file
+    data_file_->read(reinterpret_cast<char*>(data), sizeof(T));
+
+    // check for end of file
+    if (data_file_->gcount() != static_cast<std::streamsize>(sizeof(T)))
+        return undoShortRead(data_file_->gcount());
+
+    fromFileOrder(data, 1);
+    return FileStatus::ok;
+}
 
-// maybe implement move constructor and overload operator=
-// maybe implement swap()
\ No newline at end of file
+template<typename T>
+FileStatus DataFile::tryRead(T *data, int64_t pos) noexcept {
+    // move read pointer
+    FileStatus status = seekRead(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // read from file
+    return tryRead(data);
+}
+
+template<typename T>
+FileStatus DataFile::tryReadArray(T *data, int64_t len) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>, "tryReadArray() can only copy trivially copyable types.");
+
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // read from file
+    std::streamsize size = static_cast<std::streamsize>(len * sizeof(T));
+    data_file_->read(reinterpret_cast<char*>(data), size);
+
+    // check for end of file
+    if (data_file_->gcount() != size)
+        return undoShortRead(data_file_->gcount());
+
+    fromFileOrder(data, len);
+    return FileStatus::ok;
+}
+
+template<typename T>
+FileStatus DataFile::tryReadArray(T *data, int64_t len, int64_t pos) noexcept {
+    // move read pointer
+    FileStatus status = seekRead(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // read from file
+    return tryReadArray(data, len);
+}
+
+
+
+/***** TEMPLATED NON-THROWING WRITE FUNCTIONS *****/
+
+template<typename T>
+FileStatus DataFile::tryWrite(const T *data) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>, "tryWrite() can only copy trivially copyable types.");
+
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // write scalars straight to the stream buffer
+    if constexpr (isScalarSize<T>()) {
+        T value = *data;
+        if constexpr (ByteSwap::is_swappable<T>) {
+            if (swap_bytes_)
+                value = ByteSwap::swap(value);
+        }
+        if (writeScalar(&value))
+            return FileStatus::ok;
+        data_file_->setstate(std::ios::badbit);
+        return FileStatus::io_error;
+    }
+
+    // write to file
+    data_file_->write(reinterpret_cast<const char*>(data), sizeof(T));
+
+    // check for write errors
+    return data_file_->fail() ? FileStatus::io_error : FileStatus::ok;
+}
+
+template<typename T>
+FileStatus DataFile::tryWrite(const T *data, int64_t pos) noexcept {
+    // move write pointer
+    FileStatus status = seekWrite(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // write to file
+    return tryWrite(data);
+}
+
+template<typename T>
+FileStatus DataFile::tryWriteArray(const T *data, int64_t len) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>, "tryWriteArray() can only copy trivially copyable types.");
+
+    // check if file is open
+    if (!isOpen())
+        return FileStatus::not_open;
+
+    // write in file byte order
+    if constexpr (ByteSwap::is_swappable<T>) {
+        if (swap_bytes_)
+            return writeSwapped(data, len) ? FileStatus::ok : FileStatus::io_error;
+    }
+
+    // write to file
+    data_file_->write(reinterpret_cast<const char*>(data), len * sizeof(T));
+
+    // check for write errors
+    return data_file_->fail() ? FileStatus::io_error : FileStatus::ok;
+}
+
+template<typename T>
+FileStatus DataFile::tryWriteArray(const T *data, int64_t len, int64_t pos) noexcept {
+    // move write pointer
+    FileStatus status = seekWrite(pos);
+    if (status != FileStatus::ok)
+        return status;
+    // write to file
+    return tryWriteArray(data, len);
+}
+
+
+
+/***** TEMPLATED CURSOR FUNCTIONS *****/
+
+template<typename T>
+T DataFile::Cursor::get() {
+    T value;
+    get(&value);
+    return value;
+}
+
+template<typename T>
+void DataFile::Cursor::get(T *data) {
+    static_assert(std::is_trivially_copyable_v<T>, "get() can only copy trivially copyable types.");
+    assert(end_ - next_ >= static_cast<std::ptrdiff_t>(sizeof(T)));
+
+    // copy from buffer
+    std::memcpy(data, next_, sizeof(T));
+    next_ += sizeof(T);
+
+    if constexpr (ByteSwap::is_swappable<T>) {
+        if (swap_bytes_)
+            *data = ByteSwap::swap(*data);
+    }
+}
+
+template<typename T>
+void DataFile::Cursor::getArray(T *data, int64_t len) {
+    static_assert(std::is_trivially_copyable_v<T>, "getArray() can only copy trivially copyable types.");
+    assert(end_ - next_ >= static_cast<std::ptrdiff_t>(len * sizeof(T)));
+
+    // copy from buffer
+    std::memcpy(data, next_, len * sizeof(T));
+    next_ += len * sizeof(T);
+
+    if constexpr (ByteSwap::is_swappable<T>) {
+        if (swap_bytes_)
+            ByteSwap::swapArray(data, len);
+    }
+}
+
+inline void DataFile::Cursor::skip(int64_t size) {
+    assert(end_ - next_ >= size);
+    next_ += size;
+}
+
+// Returns a pointer to the next unread byte in the cursor's buffer.
+// Valid until the next reserve().
+inline const char *DataFile::Cursor::data() const { return next_; }
+
+// Returns the number of bytes that can be read without another reserve().
+inline int64_t DataFile::Cursor::available() const { return end_ - next_; }
+
+
+#endif
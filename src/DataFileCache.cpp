@@ -0,0 +1,152 @@
+
+#include "DataFileCache.h"
+
+/***** CONSTRUCTORS/DESTRUCTOR *****/
+
+DataFileCache::DataFileCache(size_t capacity):
+    capacity_(capacity == 0 ? 1 : capacity),
+    hits_(0),
+    misses_(0),
+    evictions_(0),
+    reopens_(0) { }
+
+// DataFile destructors close any files that are still open
+DataFileCache::~DataFileCache() { }
+
+/***** ACCESS FUNCTIONS *****/
+
+DataFile &DataFileCache::get(std::string file_name, std::ios::openmode mode) {
+    return get(file_name, "", mode);
+}
+
+// Returns the DataFile for file_path + file_name, opening it if needed.
+//
+// A file that is already open counts as a hit. A file that was evicted is
+// reopened with its original mode and position and counts as a miss and
+// a reopen.
+DataFile &DataFileCache::get(std::string file_name, std::string file_path, std::ios::openmode mode) {
+    std::string key = fileKey(file_name, file_path);
+    auto found = entries_.find(key);
+
+    if (found != entries_.end() && found->second.in_lru) {
+        Entry &entry = found->second;
+        // already open, just mark as most recently used
+        if (entry.file->isOpen()) {
+            ++hits_;
+            lru_.splice(lru_.begin(), lru_, entry.lru_pos);
+            return *entry.file;
+        }
+        // closed by its user, so there is no position to go back to
+        lru_.erase(entry.lru_pos);
+        entry.in_lru = false;
+        entry.read_pos = -1;
+        entry.write_pos = -1;
+    }
+
+    ++misses_;
+
+    // make room before opening another file
+    while (lru_.size() >= capacity_)
+        evict();
+
+    if (found == entries_.end()) {
+        Entry entry;
+        entry.file = std::make_unique<DataFile>(file_name, file_path, mode);
+        // never truncate on a later reopen
+        entry.mode = (mode == OpenMode::overwrite) ? OpenMode::edit : mode;
+        found = entries_.emplace(key, std::move(entry)).first;
+    } else {
+        Entry &entry = found->second;
+        entry.file->open(entry.mode);
+        if (entry.read_pos >= 0)
+            entry.file->setReadPos(entry.read_pos);
+        if (entry.write_pos >= 0)
+            entry.file->setWritePos(entry.write_pos);
+        ++reopens_;
+    }
+
+    lru_.push_front(key);
+    found->second.lru_pos = lru_.begin();
+    found->second.in_lru = true;
+
+    return *found->second.file;
+}
+
+// Closes and forgets file_path + file_name, if it is in the cache.
+void DataFileCache::erase(std::string file_name, std::string file_path) {
+    auto found = entries_.find(fileKey(file_name, file_path));
+    if (found == entries_.end())
+        return;
+
+    if (found->second.in_lru)
+        lru_.erase(found->second.lru_pos);
+    entries_.erase(found);
+}
+
+// Closes and forgets every file. Does not reset the statistics.
+void DataFileCache::clear() {
+    lru_.clear();
+    entries_.clear();
+}
+
+// Closes the least recently used open file, remembering its positions
+// so that it can be reopened where it left off.
+void DataFileCache::evict() {
+    if (lru_.empty())
+        return;
+
+    Entry &entry = entries_.at(lru_.back());
+    entry.read_pos = entry.file->getReadPos();
+    entry.write_pos = entry.file->getWritePos();
+    entry.file->close();
+    entry.in_lru = false;
+    lru_.pop_back();
+
+    ++evictions_;
+}
+
+// Returns the name a new DataFile opens for file_name, which gets the default
+// extension if it has none.
+std::string DataFileCache::fileKey(const std::string &file_name, const std::string &file_path) {
+    if (file_name.find_last_of('.') == std::string::npos)
+        return file_path + file_name + DataFile::default_file_extension;
+    return file_path + file_name;
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+size_t DataFileCache::getCapacity() const { return capacity_; }
+
+size_t DataFileCache::getOpenCount() const { return lru_.size(); }
+
+size_t DataFileCache::getFileCount() const { return entries_.size(); }
+
+int64_t DataFileCache::getHits() const { return hits_; }
+
+int64_t DataFileCache::getMisses() const { return misses_; }
+
+int64_t DataFileCache::getEvictions() const { return evictions_; }
+
+int64_t DataFileCache::getReopens() const { return reopens_; }
+
+// Returns hits / (hits + misses), or 0 if nothing has been requested yet.
+double DataFileCache::getHitRate() const {
+    int64_t total = hits_ + misses_;
+    return total == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(total);
+}
+
+/***** SETTERS/MUTATORS *****/
+
+// Changes the number of files kept open, closing files if needed.
+void DataFileCache::setCapacity(size_t capacity) {
+    capacity_ = (capacity == 0 ? 1 : capacity);
+    while (lru_.size() > capacity_)
+        evict();
+}
+
+void DataFileCache::resetStats() {
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+    reopens_ = 0;
+}
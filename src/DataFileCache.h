@@ -0,0 +1,96 @@
+/**
+ * @file DataFileCache.h
+ * @author Danielle Fukunaga
+ * @brief An LRU cache of open DataFiles for working with more files than the
+ *        process is allowed to keep open at once.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef DATA_FILE_CACHE_H
+#define DATA_FILE_CACHE_H
+
+#include "DataFile.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+/**
+ * @brief Keeps at most capacity DataFiles open, closing the least recently used
+ *        file when another one has to be opened.
+ *
+ * Closed files keep their DataFile object, so reopening one reuses its fstream
+ * and restores its read and write positions. Files first opened with
+ * OpenMode::overwrite are reopened with OpenMode::edit so that an eviction
+ * never truncates data that was already written.
+ *
+ * Files are keyed by the name they are opened with, so "x" and "x.dat" share
+ * a DataFile. A file closed by its user stays in the cache and is reopened
+ * from the start by the next get().
+ *
+ * References returned by get() stay valid until clear() or erase(), but the
+ * file they refer to may be closed by a later get(); call get() again before
+ * using a file after touching others. Not thread safe.
+ *
+ */
+class DataFileCache {
+public:
+    explicit DataFileCache(size_t capacity);
+    ~DataFileCache();
+
+    // access functions
+
+    DataFile                       &get(std::string file_name, std::ios::openmode mode = OpenMode::edit);
+    DataFile                       &get(std::string file_name, std::string file_path, std::ios::openmode mode = OpenMode::edit);
+    void                            erase(std::string file_name, std::string file_path = "");
+    void                            clear();
+
+    // getters/accessors
+
+    size_t                          getCapacity() const;
+    size_t                          getOpenCount() const;
+    size_t                          getFileCount() const;
+    int64_t                         getHits() const;
+    int64_t                         getMisses() const;
+    int64_t                         getEvictions() const;
+    int64_t                         getReopens() const;
+    double                          getHitRate() const;
+
+    // setters/mutators
+
+    void                            setCapacity(size_t capacity);
+    void                            resetStats();
+
+private:
+    struct Entry {
+        std::unique_ptr<DataFile>           file;
+        std::ios::openmode                  mode;
+        int64_t                             read_pos = -1;
+        int64_t                             write_pos = -1;
+        std::list<std::string>::iterator    lru_pos;
+        bool                                in_lru = false;
+    };
+
+    void                            evict();
+    static std::string              fileKey(const std::string &file_name, const std::string &file_path);
+
+    // member variables
+
+    size_t                          capacity_;
+    std::unordered_map<std::string, Entry>  entries_;
+    std::list<std::string>          lru_;           // keys of open files, most recent first
+    int64_t                         hits_;
+    int64_t                         misses_;
+    int64_t                         evictions_;
+    int64_t                         reopens_;
+
+};
+
+
+#endif
@@ -0,0 +1,100 @@
+
+#include "FloatSeries.h"
+#include "BitStream.h"
+
+#include <bit>
+
+namespace {
+    // the encoder and decoder for float (Bits 32) and double (Bits 64)
+    template<typename T, typename U, int Bits, int LengthBits>
+    void encodeSeries(const T *data, int64_t len, std::vector<unsigned char> &out) {
+        if (len == 0)
+            return;
+
+        BitWriter writer(out);
+        U prev = std::bit_cast<U>(data[0]);
+        writer.put(prev, Bits);
+
+        int prev_leading = Bits + 1;    // no window yet
+        int prev_trailing = 0;
+        for (int64_t i = 1; i < len; ++i) {
+            U value = std::bit_cast<U>(data[i]);
+            U diff = value ^ prev;
+            prev = value;
+
+            if (diff == 0) {
+                writer.put(0, 1);
+                continue;
+            }
+
+            int leading = std::countl_zero(diff);
+            int trailing = std::countr_zero(diff);
+            if (leading > 31)
+                leading = 31;
+
+            if (leading >= prev_leading && trailing >= prev_trailing) {
+                // reuse the previous window
+                writer.put(0x2, 2);
+                writer.put(diff >> prev_trailing, Bits - prev_leading - prev_trailing);
+            } else {
+                int length = Bits - leading - trailing;
+                writer.put(0x3, 2);
+                writer.put(static_cast<uint64_t>(leading), 5);
+                writer.put(static_cast<uint64_t>(length - 1), LengthBits);
+                writer.put(diff >> trailing, length);
+                prev_leading = leading;
+                prev_trailing = trailing;
+            }
+        }
+        writer.finish();
+    }
+
+    template<typename T, typename U, int Bits, int LengthBits>
+    bool decodeSeries(const unsigned char *in, int64_t size, T *data, int64_t len) {
+        if (len == 0)
+            return size == 0;
+
+        BitReader reader(in, size);
+        U prev = static_cast<U>(reader.get(Bits));
+        data[0] = std::bit_cast<T>(prev);
+
+        int leading = 0;
+        int trailing = 0;
+        for (int64_t i = 1; i < len; ++i) {
+            if (reader.getBit()) {
+                if (reader.getBit()) {
+                    leading = static_cast<int>(reader.get(5));
+                    int length = static_cast<int>(reader.get(LengthBits)) + 1;
+                    if (leading + length > Bits)
+                        return false;
+                    trailing = Bits - leading - length;
+                }
+                prev ^= static_cast<U>(reader.get(Bits - leading - trailing)) << trailing;
+            }
+            data[i] = std::bit_cast<T>(prev);
+        }
+
+        // everything but the padding of the last byte is used
+        return !reader.overrun() && reader.getBitsLeft() < 8;
+    }
+}
+
+/***** ENCODE *****/
+
+void FloatSeries::encode(const float *data, int64_t len, std::vector<unsigned char> &out) {
+    encodeSeries<float, uint32_t, 32, 5>(data, len, out);
+}
+
+void FloatSeries::encode(const double *data, int64_t len, std::vector<unsigned char> &out) {
+    encodeSeries<double, uint64_t, 64, 6>(data, len, out);
+}
+
+/***** DECODE *****/
+
+bool FloatSeries::decode(const unsigned char *in, int64_t size, float *data, int64_t len) {
+    return decodeSeries<float, uint32_t, 32, 5>(in, size, data, len);
+}
+
+bool FloatSeries::decode(const unsigned char *in, int64_t size, double *data, int64_t len) {
+    return decodeSeries<double, uint64_t, 64, 6>(in, size, data, len);
+}
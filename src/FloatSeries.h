@@ -0,0 +1,53 @@
+/**
+ * @file FloatSeries.h
+ * @author Danielle Fukunaga
+ * @brief XOR compression for series of floating point readings, after the
+ *        Gorilla time series encoding.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef FLOAT_SERIES_H
+#define FLOAT_SERIES_H
+
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Stores each value as the XOR of its bits with the previous value's.
+ *
+ * Neighbouring readings usually share their sign, exponent and high mantissa
+ * bits, so the XOR is mostly zeros. The bit stream, written with BitWriter,
+ * holds the first value's raw bits and then for each value:
+ *
+ * - '0'                      the value repeats the previous one
+ *
+ * - '10' + meaningful bits   the XOR fits inside the previous window of
+ *                            leading and trailing zeros
+ *
+ * - '11' + 5 bit leading zero count + 5 or 6 bit length - 1 + meaningful
+ *   bits                     a new window
+ *
+ * with 5 length bits for float and 6 for double. The leading zero count is
+ * capped at 31. Slowly changing or often repeated readings take a few bits
+ * each instead of 32 or 64.
+ *
+ */
+namespace FloatSeries {
+    // Returns the largest encoded size of len values.
+    inline int64_t maxEncodedSize(int64_t len, int bits) { return (len * (bits + 13) + 7) / 8 + 8; }
+
+    void                            encode(const float *data, int64_t len, std::vector<unsigned char> &out);
+    void                            encode(const double *data, int64_t len, std::vector<unsigned char> &out);
+
+    // Decodes size bytes into len values. Returns false if the bytes run out.
+    bool                            decode(const unsigned char *in, int64_t size, float *data, int64_t len);
+    bool                            decode(const unsigned char *in, int64_t size, double *data, int64_t len);
+}
+
+
+#endif
@@ -0,0 +1,188 @@
+
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr int min_match = 4;
+    constexpr int64_t last_literals = 5;        // the last 5 bytes are always literals
+    constexpr int64_t match_find_limit = 12;    // no match starts in the last 12 bytes
+    constexpr int64_t max_offset = 65535;
+    constexpr int hash_log = 12;
+
+    uint32_t read32(const unsigned char *p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - hash_log);
+    }
+
+    // Writes the 255-byte continuation of a length that did not fit in its
+    // token nibble.
+    unsigned char *writeLength(unsigned char *op, int64_t len) {
+        for (; len >= 255; len -= 255)
+            *op++ = 255;
+        *op++ = static_cast<unsigned char>(len);
+        return op;
+    }
+
+    // Reads the continuation of a length. Returns false if it runs past end.
+    bool readLength(const unsigned char *&ip, const unsigned char *end, int64_t &len) {
+        unsigned char byte;
+        do {
+            if (ip >= end)
+                return false;
+            byte = *ip++;
+            len += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Returns the most bytes a sequence with lit_len literals can take.
+    int64_t sequenceBound(int64_t lit_len, int64_t match_len) {
+        return 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+    }
+}
+
+/***** COMPRESS *****/
+
+int64_t Lz4::compress(const char *src, int64_t len, char *dst, int64_t capacity) {
+    const unsigned char *const base = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char *const end = base + len;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;     // start of the pending literals
+    unsigned char *op = reinterpret_cast<unsigned char*>(dst);
+    unsigned char *const op_end = op + capacity;
+
+    if (len > match_find_limit) {
+        // positions of recent 4-byte sequences, relative to base
+        uint32_t table[1 << hash_log] = {0};
+        const unsigned char *const match_limit = end - match_find_limit;
+        const unsigned char *const extend_limit = end - last_literals;
+
+        ++ip;
+        while (ip < match_limit) {
+            uint32_t h = hash(read32(ip));
+            const unsigned char *ref = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+
+            if (ref >= ip || ip - ref > max_offset || read32(ref) != read32(ip)) {
+                // skip ahead faster the longer nothing matches
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            // extend the match backwards over pending literals and forwards
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const unsigned char *match_end = ip + min_match;
+            const unsigned char *ref_end = ref + min_match;
+            while (match_end < extend_limit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+
+            int64_t lit_len = ip - anchor;
+            int64_t match_len = (match_end - ip) - min_match;
+            if (sequenceBound(lit_len, match_len) > op_end - op)
+                return 0;
+
+            // token, literals, offset, match length
+            unsigned char *token = op++;
+            *token = static_cast<unsigned char>(std::min<int64_t>(lit_len, 15) << 4);
+            if (lit_len >= 15)
+                op = writeLength(op, lit_len - 15);
+            std::memcpy(op, anchor, static_cast<size_t>(lit_len));
+            op += lit_len;
+
+            int64_t offset = ip - ref;
+            *op++ = static_cast<unsigned char>(offset);
+            *op++ = static_cast<unsigned char>(offset >> 8);
+
+            *token |= static_cast<unsigned char>(std::min<int64_t>(match_len, 15));
+            if (match_len >= 15)
+                op = writeLength(op, match_len - 15);
+
+            ip = match_end;
+            anchor = ip;
+
+            // remember a position inside the match for the next search
+            if (ip < match_limit)
+                table[hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+        }
+    }
+
+    // the rest is literals
+    int64_t lit_len = end - anchor;
+    if (1 + lit_len / 255 + 1 + lit_len > op_end - op)
+        return 0;
+
+    *op++ = static_cast<unsigned char>(std::min<int64_t>(lit_len, 15) << 4);
+    if (lit_len >= 15)
+        op = writeLength(op, lit_len - 15);
+    std::memcpy(op, anchor, static_cast<size_t>(lit_len));
+    op += lit_len;
+
+    return op - reinterpret_cast<unsigned char*>(dst);
+}
+
+/***** DECOMPRESS *****/
+
+int64_t Lz4::decompress(const char *src, int64_t len, char *dst, int64_t capacity) {
+    const unsigned char *ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char *const ip_end = ip + len;
+    unsigned char *const out = reinterpret_cast<unsigned char*>(dst);
+    unsigned char *op = out;
+    unsigned char *const op_end = out + capacity;
+
+    while (ip < ip_end) {
+        unsigned char token = *ip++;
+
+        // literals
+        int64_t lit_len = token >> 4;
+        if (lit_len == 15 && !readLength(ip, ip_end, lit_len))
+            return -1;
+        if (lit_len > ip_end - ip || lit_len > op_end - op)
+            return -1;
+        std::memcpy(op, ip, static_cast<size_t>(lit_len));
+        op += lit_len;
+        ip += lit_len;
+
+        // the last sequence has no match
+        if (ip == ip_end)
+            break;
+
+        // match
+        if (ip_end - ip < 2)
+            return -1;
+        int64_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - out)
+            return -1;
+
+        int64_t match_len = token & 15;
+        if (match_len == 15 && !readLength(ip, ip_end, match_len))
+            return -1;
+        match_len += min_match;
+        if (match_len > op_end - op)
+            return -1;
+
+        // copy 8 bytes at a time when the match does not overlap them,
+        // byte at a time for short offsets that repeat a pattern
+        const unsigned char *match = op - offset;
+        if (offset >= 8) {
+            for (; match_len >= 8; match_len -= 8, op += 8, match += 8)
+                std::memcpy(op, match, 8);
+        }
+        for (; match_len > 0; --match_len)
+            *op++ = *match++;
+    }
+
+    return op - out;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file Lz4.h
+ * @author Danielle Fukunaga
+ * @brief A small LZ4 block format compressor and decompressor for
+ *        compressed DataFile blocks.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstdint>
+
+
+/**
+ * @brief LZ4 block format: a sequence of (literals, match) pairs, each
+ *        starting with a token byte holding both lengths.
+ *
+ * compress() is a greedy single-pass matcher with a 4K entry hash table on
+ * the stack, in the spirit of LZ4's fast mode. Its output can be read by any
+ * LZ4 block decoder. decompress() checks every length and offset against
+ * both buffers, so damaged input is rejected instead of overrunning memory.
+ *
+ */
+namespace Lz4 {
+    // Returns the largest compressed size of len bytes.
+    inline int64_t bound(int64_t len) { return len + len / 255 + 16; }
+
+    // Compresses len bytes of src into dst. Returns the compressed size, or 0
+    // if it does not fit in capacity bytes.
+    int64_t compress(const char *src, int64_t len, char *dst, int64_t capacity);
+
+    // Decompresses len bytes of src into dst. Returns the decompressed size,
+    // or -1 if src is malformed or does not fit in capacity bytes.
+    int64_t decompress(const char *src, int64_t len, char *dst, int64_t capacity);
+}
+
+
+#endif
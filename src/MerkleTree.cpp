@@ -0,0 +1,141 @@
+
+#include "MerkleTree.h"
+
+#include <algorithm>
+
+namespace {
+    // final mix of MurmurHash3, spreads every input bit over the output
+    uint64_t mix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    // Returns the parent of the node at index in the level above below.
+    uint64_t parentOf(const std::vector<uint64_t> &below, int64_t index) {
+        size_t left = static_cast<size_t>(index) * 2;
+        if (left + 1 < below.size())
+            return MerkleTree::combine(below[left], below[left + 1]);
+        return below[left];
+    }
+}
+
+/***** HASH FUNCTIONS *****/
+
+// Returns the leaf hash of a block with the given CRC-32C and length.
+uint64_t MerkleTree::leafHash(uint32_t checksum, int64_t len) {
+    return mix((static_cast<uint64_t>(len) << 32) | checksum);
+}
+
+// Returns the hash of a parent node. The order of the children matters.
+uint64_t MerkleTree::combine(uint64_t left, uint64_t right) {
+    return mix(left ^ mix(right + 0x9e3779b97f4a7c15ull));
+}
+
+/***** TREE FUNCTIONS *****/
+
+// Builds the tree over leaves bottom up in O(n).
+void MerkleTree::assign(const std::vector<uint64_t> &leaves) {
+    levels_.clear();
+    if (leaves.empty())
+        return;
+
+    levels_.push_back(leaves);
+    while (levels_.back().size() > 1) {
+        const std::vector<uint64_t> &below = levels_.back();
+        std::vector<uint64_t> level((below.size() + 1) / 2);
+        for (size_t i = 0; i < level.size(); ++i)
+            level[i] = parentOf(below, static_cast<int64_t>(i));
+        levels_.push_back(std::move(level));
+    }
+}
+
+// Sets one leaf and updates its path to the root. Leaves past the end are
+// appended, with any gap filled by zero leaves.
+void MerkleTree::setLeaf(int64_t index, uint64_t hash) {
+    if (levels_.empty())
+        levels_.emplace_back();
+
+    // appending one leaf only changes the nodes on its own path
+    while (static_cast<int64_t>(levels_[0].size()) < index) {
+        levels_[0].push_back(0);
+        updatePath(static_cast<int64_t>(levels_[0].size()) - 1);
+    }
+    if (static_cast<int64_t>(levels_[0].size()) == index)
+        levels_[0].push_back(hash);
+    else
+        levels_[0][index] = hash;
+
+    updatePath(index);
+}
+
+void MerkleTree::clear() { levels_.clear(); }
+
+// Recomputes the ancestors of leaf index, growing the levels above it
+// if the leaf was just appended.
+void MerkleTree::updatePath(int64_t index) {
+    for (size_t level = 1; levels_[level - 1].size() > 1; ++level) {
+        if (level == levels_.size())
+            levels_.emplace_back();
+
+        const std::vector<uint64_t> &below = levels_[level - 1];
+        levels_[level].resize((below.size() + 1) / 2);
+        index /= 2;
+        levels_[level][index] = parentOf(below, index);
+    }
+}
+
+// Returns the indexes of the leaves that differ between this tree and other,
+// in order. Leaves that only one of the trees has count as different.
+std::vector<int64_t> MerkleTree::diff(const MerkleTree &other) const {
+    std::vector<int64_t> out;
+    int height = std::max(getHeight(), other.getHeight());
+    if (height > 0)
+        diffNode(other, height - 1, 0, out);
+    return out;
+}
+
+// Compares one node of both trees and descends into it if it differs.
+void MerkleTree::diffNode(const MerkleTree &other, int level, int64_t index, std::vector<int64_t> &out) const {
+    const uint64_t *mine = node(level, index);
+    const uint64_t *theirs = other.node(level, index);
+    if (mine == nullptr && theirs == nullptr)
+        return;
+    if (mine != nullptr && theirs != nullptr && *mine == *theirs)
+        return;
+
+    if (level == 0) {
+        out.push_back(index);
+        return;
+    }
+
+    diffNode(other, level - 1, index * 2, out);
+    diffNode(other, level - 1, index * 2 + 1, out);
+}
+
+// Returns the node at level and index, or nullptr if the tree does not
+// have it. Levels past the top of a smaller tree are treated as missing.
+const uint64_t *MerkleTree::node(int level, int64_t index) const {
+    if (level >= getHeight() || index >= static_cast<int64_t>(levels_[level].size()))
+        return nullptr;
+    return &levels_[level][index];
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+// Returns the root hash, or 0 for an empty tree.
+uint64_t MerkleTree::getRoot() const {
+    return levels_.empty() || levels_.back().empty() ? 0 : levels_.back()[0];
+}
+
+uint64_t MerkleTree::getLeaf(int64_t index) const { return levels_[0][index]; }
+
+int64_t MerkleTree::getLeafCount() const {
+    return levels_.empty() ? 0 : static_cast<int64_t>(levels_[0].size());
+}
+
+// Returns the number of levels, including the leaves.
+int MerkleTree::getHeight() const { return static_cast<int>(levels_.size()); }
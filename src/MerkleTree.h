@@ -0,0 +1,72 @@
+/**
+ * @file MerkleTree.h
+ * @author Danielle Fukunaga
+ * @brief A binary hash tree over the blocks of a file, for comparing whole
+ *        files by their root and finding changed blocks without reading them.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef MERKLE_TREE_H
+#define MERKLE_TREE_H
+
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Hash tree with one leaf per block.
+ *
+ * Each parent is the hash of its two children; a node without a sibling is
+ * carried up unchanged. Changing or appending a leaf updates only the nodes
+ * on its path to the root, so keeping the tree current costs O(log n) per
+ * block written.
+ *
+ * Two files with the same root have the same blocks. diff() walks both trees
+ * from the root and only descends into subtrees whose hashes differ, so
+ * finding the changed blocks of two replicas costs O(k log n) for k changed
+ * blocks instead of a pass over both files.
+ *
+ * The hashes guard against accidental damage, not deliberate tampering.
+ *
+ */
+class MerkleTree {
+public:
+    MerkleTree() = default;
+
+    void                            assign(const std::vector<uint64_t> &leaves);
+    void                            setLeaf(int64_t index, uint64_t hash);
+    void                            clear();
+    std::vector<int64_t>            diff(const MerkleTree &other) const;
+
+    // getters/accessors
+
+    uint64_t                        getRoot() const;
+    uint64_t                        getLeaf(int64_t index) const;
+    int64_t                         getLeafCount() const;
+    int                             getHeight() const;
+
+    // hash functions
+
+    static uint64_t                 leafHash(uint32_t checksum, int64_t len);
+    static uint64_t                 combine(uint64_t left, uint64_t right);
+
+private:
+    // helper functions
+
+    void                            updatePath(int64_t index);
+    void                            diffNode(const MerkleTree &other, int level, int64_t index,
+                                             std::vector<int64_t> &out) const;
+    const uint64_t                 *node(int level, int64_t index) const;
+
+    // member variables
+
+    std::vector<std::vector<uint64_t>> levels_;     // levels_[0] holds the leaves, levels_.back() the root
+
+};
+
+
+#endif
@@ -0,0 +1,385 @@
+/**
+ * @file Record.h
+ * @author Danielle Fukunaga
+ * @brief Compile-time field lists that generate serialize, deserialize and
+ *        size functions for plain structs.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "ByteSwap.h"
+#include "DataFile.h"
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/***** FIELD HELPERS *****/
+
+namespace RecordDetail {
+    // member pointer traits
+    template<typename M> struct MemberTraits;
+    template<typename C, typename T> struct MemberTraits<T C::*> {
+        using Class = C;
+        using Type = T;
+    };
+
+    template<auto M> using ClassOf = typename MemberTraits<decltype(M)>::Class;
+    template<auto M> using TypeOf = typename MemberTraits<decltype(M)>::Type;
+
+    // true if A and B point to the same member
+    template<auto A, auto B> constexpr bool sameMember() {
+        if constexpr (std::is_same_v<decltype(A), decltype(B)>)
+            return A == B;
+        else
+            return false;
+    }
+
+    // fixed-size fields are copied as raw bytes, everything else goes
+    // through the matching DataFile read/write overload
+    template<typename T> constexpr bool is_fixed = std::is_trivially_copyable_v<T>;
+
+    // Return the number of bytes DataFile writes for a value.
+    template<typename T>
+    int64_t sizeOf(const T &value, StringEncoding encoding);
+    template<typename C, typename A>
+    int64_t sizeOf(const std::basic_string<char, C, A> &str, StringEncoding encoding);
+    template<typename T, typename A>
+    int64_t sizeOf(const std::vector<T, A> &vec, StringEncoding encoding);
+    template<typename T, size_t N>
+    int64_t sizeOf(const std::array<T, N> &arr, StringEncoding encoding);
+    template<typename K, typename V, typename C, typename A>
+    int64_t sizeOf(const std::map<K, V, C, A> &map, StringEncoding encoding);
+
+    template<typename T>
+    int64_t sizeOf(const T &, StringEncoding) {
+        static_assert(is_fixed<T>, "No DataFile overload for this field type.");
+        return sizeof(T);
+    }
+
+    template<typename C, typename A>
+    int64_t sizeOf(const std::basic_string<char, C, A> &str, StringEncoding encoding) {
+        return DataFile::lengthSize(str.length(), encoding) + static_cast<int64_t>(str.length());
+    }
+
+    template<typename T, typename A>
+    int64_t sizeOf(const std::vector<T, A> &vec, StringEncoding encoding) {
+        int64_t size = DataFile::lengthSize(vec.size(), encoding);
+        if constexpr (is_fixed<T>) {
+            size += static_cast<int64_t>(vec.size() * sizeof(T));
+        } else {
+            for (const auto &value : vec)
+                size += sizeOf(value, encoding);
+        }
+        return size;
+    }
+
+    template<typename T, size_t N>
+    int64_t sizeOf(const std::array<T, N> &arr, [[maybe_unused]] StringEncoding encoding) {
+        if constexpr (is_fixed<T>) {
+            return sizeof(arr);
+        } else {
+            int64_t size = 0;
+            for (const T &value : arr)
+                size += sizeOf(value, encoding);
+            return size;
+        }
+    }
+
+    template<typename K, typename V, typename C, typename A>
+    int64_t sizeOf(const std::map<K, V, C, A> &map, StringEncoding encoding) {
+        int64_t size = DataFile::lengthSize(map.size(), encoding);
+        for (const auto &[key, value] : map)
+            size += sizeOf(key, encoding) + sizeOf(value, encoding);
+        return size;
+    }
+
+    // schema hash tags, part of the file format: never renumber them
+    enum class FieldKind : uint8_t {
+        boolean = 1,
+        character = 2,
+        signed_integer = 3,
+        unsigned_integer = 4,
+        floating_point = 5,
+        bytes = 6,              // any other fixed-size type, by size
+        array = 7,              // then the element count and element
+        string = 8,
+        container = 9           // then the element, or the key and value
+    };
+
+    // FNV-1a, fed 8 bytes at a time
+    struct SchemaHash {
+        uint64_t                    value = 0xcbf29ce484222325ull;
+
+        constexpr void mix(uint64_t bits) {
+            for (int i = 0; i < 8; ++i) {
+                value ^= (bits >> (8 * i)) & 0xFF;
+                value *= 0x100000001b3ull;
+            }
+        }
+        constexpr void mix(FieldKind kind) { mix(static_cast<uint64_t>(kind)); }
+    };
+
+    // Mixes the on-disk layout of T into a schema hash, so the same layout
+    // hashes the same whatever compiler and standard library wrote it.
+    template<typename T>
+    struct SchemaTag {
+        static constexpr void mix(SchemaHash &hash) {
+            static_assert(is_fixed<T>, "No DataFile overload for this field type.");
+            if constexpr (std::is_same_v<T, bool>) {
+                hash.mix(FieldKind::boolean);
+            } else if constexpr (std::is_same_v<T, char>) {
+                // signed or not depending on the platform, same bytes either way
+                hash.mix(FieldKind::character);
+            } else if constexpr (std::is_enum_v<T>) {
+                SchemaTag<std::underlying_type_t<T>>::mix(hash);
+                return;
+            } else if constexpr (std::is_integral_v<T>) {
+                hash.mix(std::is_signed_v<T> ? FieldKind::signed_integer : FieldKind::unsigned_integer);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                hash.mix(FieldKind::floating_point);
+            } else if constexpr (std::is_array_v<T>) {
+                hash.mix(FieldKind::array);
+                hash.mix(std::extent_v<T>);
+                SchemaTag<std::remove_extent_t<T>>::mix(hash);
+                return;
+            } else {
+                hash.mix(FieldKind::bytes);
+            }
+            hash.mix(sizeof(T));
+        }
+    };
+
+    template<typename C, typename A>
+    struct SchemaTag<std::basic_string<char, C, A>> {
+        static constexpr void mix(SchemaHash &hash) { hash.mix(FieldKind::string); }
+    };
+
+    template<typename T, typename A>
+    struct SchemaTag<std::vector<T, A>> {
+        static constexpr void mix(SchemaHash &hash) {
+            hash.mix(FieldKind::container);
+            SchemaTag<T>::mix(hash);
+        }
+    };
+
+    template<typename T, size_t N>
+    struct SchemaTag<std::array<T, N>> {
+        static constexpr void mix(SchemaHash &hash) {
+            hash.mix(FieldKind::array);
+            hash.mix(N);
+            SchemaTag<T>::mix(hash);
+        }
+    };
+
+    template<typename K, typename V, typename C, typename A>
+    struct SchemaTag<std::map<K, V, C, A>> {
+        static constexpr void mix(SchemaHash &hash) {
+            hash.mix(FieldKind::container);
+            SchemaTag<K>::mix(hash);
+            SchemaTag<V>::mix(hash);
+        }
+    };
+}
+
+/**
+ * @brief A list of the fields of a struct, in file order.
+ *
+ * Describing a struct once with its member pointers generates its serialize,
+ * deserialize and size functions:
+ *
+ *     using TestItemFields = RecordFields<&TestItem::test_id, &TestItem::test_str, ...>;
+ *     TestItemFields::serialize(file, item);
+ *
+ * Trivially copyable fields are fixed size. Each run of adjacent fixed-size
+ * fields is gathered into one buffer and written with a single writeArray call,
+ * and read back with a single readArray call. The run boundaries and buffer
+ * size are worked out at compile time. Strings and containers use the matching
+ * DataFile overloads. The layout, including byte order, is the same as writing
+ * every field with its own call.
+ *
+ */
+template<auto... Members>
+class RecordFields {
+public:
+    static_assert(sizeof...(Members) > 0, "A record needs at least one field.");
+
+    using Type = RecordDetail::ClassOf<std::get<0>(std::tuple{Members...})>;
+
+    static constexpr size_t         field_count = sizeof...(Members);
+    // total size of all fixed-size fields
+    static constexpr int64_t        static_size =
+        ((RecordDetail::is_fixed<RecordDetail::TypeOf<Members>> ? sizeof(RecordDetail::TypeOf<Members>) : 0) + ...);
+    // true if every field is fixed size
+    static constexpr bool           is_fixed_size =
+        (RecordDetail::is_fixed<RecordDetail::TypeOf<Members>> && ...);
+    // hash of the field layout, for FileHeader::schema_hash
+    static constexpr uint64_t       schema_hash = [] {
+        RecordDetail::SchemaHash hash;
+        hash.mix(field_count);
+        (RecordDetail::SchemaTag<RecordDetail::TypeOf<Members>>::mix(hash), ...);
+        return hash.value;
+    }();
+
+    // member pointer and type of field I
+    template<size_t I> static constexpr auto member = std::get<I>(std::tuple{Members...});
+    template<size_t I> using FieldType = RecordDetail::TypeOf<member<I>>;
+
+    // position of member M in the field list, or field_count if it is not a field
+    template<auto M> static constexpr size_t indexOf() {
+        size_t index = field_count;
+        size_t i = 0;
+        ((index = (index == field_count && RecordDetail::sameMember<M, Members>()) ? i : index, ++i), ...);
+        return index;
+    }
+
+    static void                     serialize(DataFile &file, const Type &record);
+    static void                     serialize(DataFile &file, const Type &record, int64_t pos);
+    static void                     deserialize(DataFile &file, Type &record);
+    static void                     deserialize(DataFile &file, Type &record, int64_t pos);
+    static int64_t                  size(const Type &record, StringEncoding encoding = StringEncoding::fixed16);
+
+private:
+    static constexpr std::array<bool, field_count>      fixed_ = {RecordDetail::is_fixed<RecordDetail::TypeOf<Members>>...};
+    static constexpr std::array<size_t, field_count>    sizes_ = {sizeof(RecordDetail::TypeOf<Members>)...};
+
+    // For the first field of each run of fixed-size fields, the size of the
+    // whole run. 0 for every other field.
+    static constexpr std::array<size_t, field_count>    runs_ = [] {
+        std::array<size_t, field_count> runs{};
+        size_t run = 0;
+        for (size_t i = field_count; i-- > 0; ) {
+            run = fixed_[i] ? run + sizes_[i] : 0;
+            bool starts_run = fixed_[i] && (i == 0 || !fixed_[i - 1]);
+            runs[i] = starts_run ? run : 0;
+        }
+        return runs;
+    }();
+
+    // true for the last field of a run of fixed-size fields
+    static constexpr bool           endsRun(size_t i) {
+        return fixed_[i] && (i + 1 == field_count || !fixed_[i + 1]);
+    }
+
+    template<size_t... I>
+    static void                     serializeFields(DataFile &file, const Type &record, std::index_sequence<I...>);
+    template<size_t... I>
+    static void                     deserializeFields(DataFile &file, Type &record, std::index_sequence<I...>);
+
+};
+
+/***** SERIALIZE/DESERIALIZE *****/
+
+template<auto... Members>
+void RecordFields<Members...>::serialize(DataFile &file, const Type &record) {
+    serializeFields(file, record, std::make_index_sequence<field_count>());
+}
+
+template<auto... Members>
+void RecordFields<Members...>::serialize(DataFile &file, const Type &record, int64_t pos) {
+    // move write pointer
+    file.setWritePos(pos);
+    // write to file
+    serialize(file, record);
+}
+
+template<auto... Members>
+void RecordFields<Members...>::deserialize(DataFile &file, Type &record) {
+    deserializeFields(file, record, std::make_index_sequence<field_count>());
+}
+
+template<auto... Members>
+void RecordFields<Members...>::deserialize(DataFile &file, Type &record, int64_t pos) {
+    // move read pointer
+    file.setReadPos(pos);
+    // read from file
+    deserialize(file, record);
+}
+
+// Returns the number of bytes serialize() writes for record.
+template<auto... Members>
+int64_t RecordFields<Members...>::size(const Type &record, StringEncoding encoding) {
+    if constexpr (is_fixed_size) {
+        return static_size;
+    } else {
+        int64_t variable_size = 0;
+        ((variable_size += RecordDetail::is_fixed<RecordDetail::TypeOf<Members>>
+                           ? 0 : RecordDetail::sizeOf(record.*Members, encoding)), ...);
+        return static_size + variable_size;
+    }
+}
+
+template<auto... Members>
+template<size_t... I>
+void RecordFields<Members...>::serializeFields(DataFile &file, const Type &record, std::index_sequence<I...>) {
+    char buffer[static_size > 0 ? static_size : 1];
+    int64_t used = 0;
+    bool swap_bytes = file.needsByteSwap();
+
+    auto field = [&](const auto &value, auto index) {
+        constexpr size_t i = decltype(index)::value;
+        if constexpr (fixed_[i]) {
+            // gather fixed-size fields, in file byte order
+            if (swap_bytes) {
+                std::remove_cvref_t<decltype(value)> swapped;
+                std::memcpy(&swapped, &value, sizeof(value));
+                ByteSwap::swapValue(swapped);
+                std::memcpy(buffer + used, &swapped, sizeof(value));
+            } else {
+                std::memcpy(buffer + used, &value, sizeof(value));
+            }
+            used += sizeof(value);
+            // write the run after its last field
+            if constexpr (endsRun(i)) {
+                file.writeArray(buffer, used);
+                used = 0;
+            }
+        } else {
+            file.write(value);
+        }
+    };
+
+    (field(record.*Members, std::integral_constant<size_t, I>()), ...);
+}
+
+template<auto... Members>
+template<size_t... I>
+void RecordFields<Members...>::deserializeFields(DataFile &file, Type &record, std::index_sequence<I...>) {
+    char buffer[static_size > 0 ? static_size : 1];
+    int64_t used = 0;
+    bool swap_bytes = file.needsByteSwap();
+
+    auto field = [&](auto &value, auto index) {
+        constexpr size_t i = decltype(index)::value;
+        if constexpr (fixed_[i]) {
+            // read the whole run at its first field
+            if constexpr (runs_[i] != 0) {
+                file.readArray(buffer, static_cast<int64_t>(runs_[i]));
+                used = 0;
+            }
+            std::memcpy(&value, buffer + used, sizeof(value));
+            used += sizeof(value);
+            if (swap_bytes)
+                ByteSwap::swapValue(value);
+        } else {
+            file.read(value);
+        }
+    };
+
+    (field(record.*Members, std::integral_constant<size_t, I>()), ...);
+}
+
+
+#endif
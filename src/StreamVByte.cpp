@@ -0,0 +1,138 @@
+
+#include "StreamVByte.h"
+#include "CpuFeatures.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(DATAFILE_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // data bytes of the 4 values described by each control byte
+    constexpr std::array<uint8_t, 256> lengths = [] {
+        std::array<uint8_t, 256> table{};
+        for (int c = 0; c < 256; ++c)
+            table[c] = static_cast<uint8_t>(4 + (c & 3) + ((c >> 2) & 3) + ((c >> 4) & 3) + ((c >> 6) & 3));
+        return table;
+    }();
+
+#if defined(DATAFILE_X86)
+    // shuffle masks that spread the data bytes of 4 values over 4 lanes,
+    // filling the unused high bytes with zeros (index -1)
+    alignas(16) constexpr std::array<std::array<int8_t, 16>, 256> shuffles = [] {
+        std::array<std::array<int8_t, 16>, 256> table{};
+        for (int c = 0; c < 256; ++c) {
+            int8_t next = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                int len = ((c >> (2 * lane)) & 3) + 1;
+                for (int b = 0; b < 4; ++b)
+                    table[c][4 * lane + b] = b < len ? next++ : -1;
+            }
+        }
+        return table;
+    }();
+
+#if defined(__SSSE3__)
+    constexpr bool has_ssse3 = true;
+#else
+    const bool has_ssse3 = CpuFeatures::hasSsse3();
+#endif
+
+    // Decodes the values of the first full control bytes, one pshufb per 4
+    // values, and returns the end of their data.
+    DATAFILE_TARGET("ssse3")
+    const unsigned char *decodeGroupsSsse3(const unsigned char *control, const unsigned char *ip, int64_t full,
+                                           uint32_t *out, bool zigzag) {
+        const __m128i one = _mm_set1_epi32(1);
+        for (int64_t i = 0; i < full; ++i) {
+            unsigned char c = control[i];
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip));
+            __m128i values = _mm_shuffle_epi8(bytes, _mm_load_si128(reinterpret_cast<const __m128i*>(shuffles[c].data())));
+            if (zigzag) {
+                values = _mm_xor_si128(_mm_srli_epi32(values, 1),
+                                       _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(values, one)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), values);
+            ip += lengths[c];
+        }
+        return ip;
+    }
+#endif
+
+    int valueLength(uint32_t value) {
+        return 1 + (value > 0xFF) + (value > 0xFFFF) + (value > 0xFFFFFF);
+    }
+
+    uint32_t unzigzag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+    // Same as decodeGroupsSsse3(), a value at a time.
+    const unsigned char *decodeGroups(const unsigned char *control, const unsigned char *ip, int64_t full,
+                                      uint32_t *out, bool zigzag) {
+        for (int64_t i = 0; i < full; ++i) {
+            unsigned char c = control[i];
+            for (int lane = 0; lane < 4; ++lane) {
+                int bytes = ((c >> (2 * lane)) & 3) + 1;
+                uint32_t value = 0;
+                for (int b = 0; b < bytes; ++b)
+                    value |= static_cast<uint32_t>(ip[b]) << (8 * b);
+                ip += bytes;
+                out[4 * i + lane] = zigzag ? unzigzag(value) : value;
+            }
+        }
+        return ip;
+    }
+}
+
+/***** ENCODE *****/
+
+int64_t StreamVByte::encode(const uint32_t *in, int64_t len, unsigned char *control, unsigned char *data) {
+    unsigned char *op = data;
+    std::memset(control, 0, static_cast<size_t>(controlSize(len)));
+    for (int64_t i = 0; i < len; ++i) {
+        uint32_t value = in[i];
+        int bytes = valueLength(value);
+        control[i / 4] |= static_cast<unsigned char>((bytes - 1) << (2 * (i % 4)));
+        for (int b = 0; b < bytes; ++b)
+            *op++ = static_cast<unsigned char>(value >> (8 * b));
+    }
+    return op - data;
+}
+
+/***** DECODE *****/
+
+int64_t StreamVByte::dataSize(const unsigned char *control, int64_t len) {
+    int64_t full = len / 4;
+    int64_t size = 0;
+    for (int64_t i = 0; i < full; ++i)
+        size += lengths[control[i]];
+
+    // only the used fields of the last control byte
+    for (int64_t i = 4 * full; i < len; ++i)
+        size += ((control[full] >> (2 * (i % 4))) & 3) + 1;
+    return size;
+}
+
+void StreamVByte::decode(const unsigned char *control, const unsigned char *data, int64_t len,
+                         uint32_t *out, bool zigzag) {
+    int64_t full = len / 4;
+    const unsigned char *ip;
+
+#if defined(DATAFILE_X86)
+    if (has_ssse3)
+        ip = decodeGroupsSsse3(control, data, full, out, zigzag);
+    else
+#endif
+        ip = decodeGroups(control, data, full, out, zigzag);
+
+    // the values of the last, partly used control byte
+    for (int64_t i = 4 * full; i < len; ++i) {
+        int bytes = ((control[full] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t value = 0;
+        for (int b = 0; b < bytes; ++b)
+            value |= static_cast<uint32_t>(ip[b]) << (8 * b);
+        ip += bytes;
+        out[i] = zigzag ? unzigzag(value) : value;
+    }
+}
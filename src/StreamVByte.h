@@ -0,0 +1,124 @@
+/**
+ * @file StreamVByte.h
+ * @author Danielle Fukunaga
+ * @brief Stream VByte: variable-length 32-bit integers with their lengths
+ *        kept apart in control bytes, so decoding is a table lookup and a
+ *        byte shuffle per 4 values.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef STREAM_VBYTE_H
+#define STREAM_VBYTE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+
+/**
+ * @brief Stores each value in 1 to 4 little-endian bytes.
+ *
+ * An encoded array of len values is (len + 3) / 4 control bytes followed by
+ * the data bytes. Each control byte holds the byte length - 1 of 4 values in
+ * 2 bit fields, the first value in the low bits. Splitting the lengths from
+ * the data lets the decoder find the bytes of 4 values with one lookup of the
+ * control byte and move them into place with one SSSE3 shuffle, instead of
+ * testing every byte like LEB128 does. The shuffle is used on any x86 CPU
+ * with SSSE3, checked at run time; other CPUs decode a value at a time.
+ *
+ * Integers of up to 32 bits are stored. Signed values are zigzag encoded
+ * first, so small negative numbers also take 1 byte.
+ *
+ */
+namespace StreamVByte {
+    // bytes the decoder may read past the end of the data
+    constexpr int64_t               padding = 16;
+
+    // Returns the number of control bytes for len values.
+    inline int64_t                  controlSize(int64_t len) { return (len + 3) / 4; }
+
+    // Returns the largest data size of len values.
+    inline int64_t                  maxDataSize(int64_t len) { return 4 * len; }
+
+    // Encodes len values into control and data. Returns the data size.
+    int64_t                         encode(const uint32_t *in, int64_t len, unsigned char *control, unsigned char *data);
+
+    // Returns the data size described by the control bytes of len values.
+    int64_t                         dataSize(const unsigned char *control, int64_t len);
+
+    // Decodes len values. data must be followed by padding readable bytes.
+    // With zigzag, each value is zigzag decoded as well.
+    void                            decode(const unsigned char *control, const unsigned char *data, int64_t len,
+                                           uint32_t *out, bool zigzag);
+
+    template<typename T>
+    void                            encode(const T *data, int64_t len, std::vector<unsigned char> &out);
+    template<typename T>
+    bool                            decode(const unsigned char *in, int64_t size, T *data, int64_t len);
+}
+
+/***** INTEGER ARRAYS *****/
+
+namespace StreamVByteDetail {
+    // integers of up to 32 bits, including plain char
+    template<typename T> constexpr bool is_encodable = std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 4;
+}
+
+// Appends the control and data bytes of len values to out.
+template<typename T>
+void StreamVByte::encode(const T *data, int64_t len, std::vector<unsigned char> &out) {
+    static_assert(StreamVByteDetail::is_encodable<T>, "Only integers of up to 32 bits can be encoded.");
+
+    std::vector<uint32_t> values(static_cast<size_t>(len));
+    for (int64_t i = 0; i < len; ++i) {
+        if constexpr (std::is_signed_v<T>) {
+            int32_t value = data[i];
+            values[i] = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        } else {
+            values[i] = data[i];
+        }
+    }
+
+    size_t start = out.size();
+    int64_t control_size = controlSize(len);
+    out.resize(start + static_cast<size_t>(control_size + maxDataSize(len)));
+    unsigned char *control = out.data() + start;
+    int64_t data_size = encode(values.data(), len, control, control + control_size);
+    out.resize(start + static_cast<size_t>(control_size + data_size));
+}
+
+// Decodes size bytes into len values. in must be followed by padding readable
+// bytes. Returns false if the bytes are not exactly len values of T.
+template<typename T>
+bool StreamVByte::decode(const unsigned char *in, int64_t size, T *data, int64_t len) {
+    static_assert(StreamVByteDetail::is_encodable<T>, "Only integers of up to 32 bits can be decoded.");
+
+    int64_t control_size = controlSize(len);
+    if (size < control_size || size - control_size != dataSize(in, len))
+        return false;
+
+    if constexpr (std::is_same_v<std::make_unsigned_t<T>, uint32_t>) {
+        // straight into the caller's array
+        decode(in, in + control_size, len, reinterpret_cast<uint32_t*>(data), std::is_signed_v<T>);
+        return true;
+    } else {
+        std::vector<uint32_t> values(static_cast<size_t>(len));
+        decode(in, in + control_size, len, values.data(), std::is_signed_v<T>);
+        for (int64_t i = 0; i < len; ++i) {
+            T value = static_cast<T>(values[i]);
+            // the value must survive the round trip through T
+            if (static_cast<uint32_t>(value) != values[i])
+                return false;
+            data[i] = value;
+        }
+        return true;
+    }
+}
+
+
+#endif
@@ -0,0 +1,96 @@
+
+#include "StringArena.h"
+
+#include <cstdint>
+
+namespace {
+    // Returns the number of bytes needed to move data up to a multiple of alignment.
+    size_t paddingFor(const char *data, size_t alignment) {
+        return static_cast<size_t>(-reinterpret_cast<uintptr_t>(data)) & (alignment - 1);
+    }
+}
+
+/***** CONSTRUCTORS *****/
+
+StringArena::StringArena(size_t chunk_size):
+    chunk_size_(chunk_size == 0 ? default_chunk_size : chunk_size),
+    current_(0),
+    used_(0),
+    bytes_used_(0) { }
+
+/***** ALLOCATION FUNCTIONS *****/
+
+// Returns size bytes of memory aligned to alignment that stay valid until
+// reset() or release().
+//
+// Moves on to the next chunk when the current one is full, and only allocates
+// a new chunk when none of the remaining ones are large enough.
+void *StringArena::do_allocate(size_t size, size_t alignment) {
+    bytes_used_ += size;
+
+    // fits in the current chunk
+    if (current_ < chunks_.size()) {
+        char *data = chunks_[current_].data.get() + used_;
+        size_t padding = paddingFor(data, alignment);
+        if (chunks_[current_].size - used_ >= size + padding) {
+            used_ += padding + size;
+            return data + padding;
+        }
+    }
+
+    // move on to the next chunk that is large enough
+    if (!chunks_.empty()) {
+        while (++current_ < chunks_.size()) {
+            char *data = chunks_[current_].data.get();
+            size_t padding = paddingFor(data, alignment);
+            if (chunks_[current_].size >= size + padding) {
+                used_ = padding + size;
+                return data + padding;
+            }
+        }
+    }
+
+    // no room left, add a chunk
+    size_t chunk_size = (size + alignment > chunk_size_) ? size + alignment : chunk_size_;
+    chunks_.push_back({std::make_unique_for_overwrite<char[]>(chunk_size), chunk_size});
+    current_ = chunks_.size() - 1;
+
+    char *data = chunks_[current_].data.get();
+    size_t padding = paddingFor(data, alignment);
+    used_ = padding + size;
+
+    return data + padding;
+}
+
+// Memory is only given back by reset() or release().
+void StringArena::do_deallocate(void *, size_t, size_t) { }
+
+bool StringArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+// Makes all memory available again, keeping the chunks.
+void StringArena::reset() {
+    current_ = 0;
+    used_ = 0;
+    bytes_used_ = 0;
+}
+
+// Frees all chunks.
+void StringArena::release() {
+    chunks_.clear();
+    reset();
+}
+
+/***** GETTERS/ACCESSORS *****/
+
+// Returns the number of bytes handed out since the last reset.
+size_t StringArena::getBytesUsed() const { return bytes_used_; }
+
+// Returns the total size of all chunks.
+size_t StringArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Chunk &chunk : chunks_)
+        capacity += chunk.size;
+    return capacity;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file StringArena.h
+ * @author Danielle Fukunaga
+ * @brief A chunked bump allocator for reading many strings and records
+ *        without a heap allocation per string.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+
+/**
+ * @brief Hands out memory from a list of chunks that are only freed together.
+ *
+ * Allocations never move, so pointers into the arena stay valid until reset()
+ * or release(). reset() keeps the chunks for reuse, so once the arena has grown
+ * to the size of a batch, later batches of the same size do not allocate.
+ *
+ * StringArena is a std::pmr::memory_resource, so std::pmr strings and containers
+ * can be backed by it. deallocate() does nothing; a whole batch is freed at once
+ * by reset(), which is O(1).
+ *
+ */
+class StringArena : public std::pmr::memory_resource {
+public:
+    explicit StringArena(size_t chunk_size = default_chunk_size);
+
+    StringArena(const StringArena &) = delete;
+    StringArena                    &operator=(const StringArena &) = delete;
+
+    void                            reset();
+    void                            release();
+
+    // getters/accessors
+
+    size_t                          getBytesUsed() const;
+    size_t                          getCapacity() const;
+
+    // static constants
+
+    static constexpr size_t         default_chunk_size = 64 * 1024;
+
+protected:
+    // memory_resource overrides
+
+    void                           *do_allocate(size_t size, size_t alignment) override;
+    void                            do_deallocate(void *data, size_t size, size_t alignment) override;
+    bool                            do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]>     data;
+        size_t                      size;
+    };
+
+    // member variables
+
+    std::vector<Chunk>              chunks_;
+    size_t                          chunk_size_;
+    size_t                          current_;       // index of the chunk being filled
+    size_t                          used_;          // bytes used in the current chunk
+    size_t                          bytes_used_;    // bytes handed out since the last reset
+
+};
+
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file Varint.h
+ * @author Danielle Fukunaga
+ * @brief LEB128 variable-length integer encoding used for length prefixes.
+ * @version 0.1
+ * @date 2024-09-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+
+/**
+ * @brief Unsigned LEB128: 7 bits per byte, least significant group first,
+ *        with the high bit set on every byte except the last.
+ *
+ * Values below 128 take 1 byte and 64-bit values take at most 10.
+ *
+ */
+namespace Varint {
+    // the most bytes a 64-bit value can take
+    constexpr int max_length = 10;
+
+    // Returns the number of bytes needed to encode value.
+    inline int size(uint64_t value) {
+        int bits = 64 - std::countl_zero(value | 1);
+        return (bits + 6) / 7;
+    }
+
+    // Writes value to out and returns the number of bytes written.
+    // out must have room for max_length bytes.
+    inline int encode(uint64_t value, unsigned char *out) {
+        int len = 0;
+        while (value >= 0x80) {
+            out[len++] = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+        out[len++] = static_cast<unsigned char>(value);
+        return len;
+    }
+
+    // Decodes one value from in, reading no further than end.
+    // Returns the number of bytes used, or 0 if the value is truncated or
+    // longer than max_length bytes.
+    //
+    // When 8 bytes are readable, values up to 8 bytes long are decoded
+    // without a per-byte loop: the terminating byte is found from the high
+    // bits of one 64-bit load and the 7-bit groups are packed with shifts
+    // (or a single pext when BMI2 is available).
+    inline int decode(const unsigned char *in, const unsigned char *end, uint64_t *value) {
+        // one byte, by far the most common case for length prefixes
+        if (in < end && in[0] < 0x80) {
+            *value = in[0];
+            return 1;
+        }
+
+        if (end - in >= 8 && std::endian::native == std::endian::little) {
+            uint64_t word;
+            std::memcpy(&word, in, sizeof(word));
+
+            uint64_t stops = ~word & 0x8080808080808080ull;
+            if (stops != 0) {
+                int len = std::countr_zero(stops) / 8 + 1;
+                // keep only the bytes of this value
+                word &= (len == 8) ? ~0ull : ((1ull << (len * 8)) - 1);
+#if defined(__BMI2__)
+                *value = _pext_u64(word, 0x7F7F7F7F7F7F7F7Full);
+#else
+                word &= 0x7F7F7F7F7F7F7F7Full;
+                word = ((word & 0x7F007F007F007F00ull) >> 1) | (word & 0x007F007F007F007Full);
+                word = ((word & 0x3FFF00003FFF0000ull) >> 2) | (word & 0x00003FFF00003FFFull);
+                word = ((word & 0x0FFFFFFF00000000ull) >> 4) | (word & 0x000000000FFFFFFFull);
+                *value = word;
+#endif
+                return len;
+            }
+        }
+
+        // general case, byte at a time
+        uint64_t result = 0;
+        for (int i = 0; i < max_length && in + i < end; ++i) {
+            result |= static_cast<uint64_t>(in[i] & 0x7F) << (7 * i);
+            if (in[i] < 0x80) {
+                *value = result;
+                return i + 1;
+            }
+        }
+
+        return 0;
+    }
+}
+
+
+#endif